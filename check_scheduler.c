@@ -2,8 +2,27 @@
 #include "stat.h"
 #include "user.h"
 #include "fs.h"
+#include "sched.h"
+#include "date.h"
 
-int main(int argc, char *argv[])
+#define NELEM(x) (sizeof(x)/sizeof((x)[0]))
+
+// usage: check_scheduler [rr|fcfs|pbs|mlfq|cfs|stride|lottery|all]...
+// Runs the same workload under each named policy in turn and
+// reports the elapsed microseconds, so one boot can compare them all.
+
+char *names[] = {
+[SCHED_ROUND_ROBIN] "rr",
+[SCHED_FCFS]        "fcfs",
+[SCHED_PBS]         "pbs",
+[SCHED_MLFQ]        "mlfq",
+[SCHED_CFS]         "cfs",
+[SCHED_STRIDE]      "stride",
+[SCHED_LOTTERY]     "lottery",
+};
+
+void
+workload(void)
 {
   for(int i = 0; i < 100; i++)
   {
@@ -30,5 +49,58 @@ int main(int argc, char *argv[])
   {
     wait();
   }
+}
+
+// Microseconds since boot; wraps after about 71 minutes.
+uint
+usnow(void)
+{
+  struct timespec ts;
+
+  tpclock(&ts);
+  return ts.sec * 1000000 + ts.nsec / 1000;
+}
+
+void
+run(int policy)
+{
+  int old;
+  uint start;
+
+  old = set_scheduler(policy);
+  if(old < 0){
+    printf(2, "check_scheduler: set_scheduler %s failed\n", names[policy]);
+    return;
+  }
+  start = usnow();
+  workload();
+  printf(1, "%s: %d us\n", names[policy], usnow() - start);
+  set_scheduler(old);
+}
+
+int main(int argc, char *argv[])
+{
+  int i, p;
+
+  if(argc < 2){
+    workload();
+    exit();
+  }
+
+  for(i = 1; i < argc; i++){
+    if(strcmp(argv[i], "all") == 0){
+      for(p = 0; p < NELEM(names); p++)
+        run(p);
+      continue;
+    }
+    for(p = 0; p < NELEM(names); p++)
+      if(strcmp(argv[i], names[p]) == 0)
+        break;
+    if(p == NELEM(names)){
+      printf(2, "check_scheduler: unknown policy %s\n", argv[i]);
+      exit();
+    }
+    run(p);
+  }
   exit();
 }
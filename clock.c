@@ -0,0 +1,94 @@
+// Time stamp counter clock.
+//
+// clockinit() measures the TSC rate against the 8254 PIT,
+// whose input clock is a fixed 1193182 Hz, so cycle counts
+// taken with rdtsc() can be turned into nanoseconds.  The
+// TSC is assumed to run at a constant rate and in step on
+// every cpu, as it does on anything recent and under QEMU.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "date.h"
+
+#define PIT_HZ   1193182
+#define PIT_CH2  0x42         // Channel 2 data port
+#define PIT_MODE 0x43         // Mode/command port
+#define PORTB    0x61         // Channel 2 gate (bit 0) and output (bit 5)
+#define CALMS    10           // Calibrate over this many ms
+
+uint tsckhz;                  // TSC cycles per millisecond
+uint64 tscboot;               // rdtsc() at clockinit()
+static uint tscmult;          // ns per cycle << TSCSHIFT
+
+// The user-visible copy, a page of its own so that
+// setupkvm() can map it without exposing anything else.
+static union {
+  struct timepage tp;
+  char page[PGSIZE];
+} timepage __attribute__((aligned(PGSIZE)));
+
+void
+clockinit(void)
+{
+  uint latch, spins;
+  uint64 t0, t1;
+
+  // One-shot count down on channel 2, gated on, speaker off;
+  // bit 5 of port B goes high when the count reaches zero.
+  latch = PIT_HZ / 1000 * CALMS;
+  outb(PORTB, (inb(PORTB) & ~0x02) | 0x01);
+  outb(PIT_MODE, 0xB0);
+  outb(PIT_CH2, latch & 0xFF);
+  outb(PIT_CH2, latch >> 8);
+  t0 = rdtsc();
+  for(spins = 0; (inb(PORTB) & 0x20) == 0 && spins < 100000000; spins++)
+    ;
+  t1 = rdtsc();
+
+  tsckhz = div64(t1 - t0, CALMS);
+  if((inb(PORTB) & 0x20) == 0 || tsckhz == 0){
+    cprintf("clockinit: no PIT, assuming 1 GHz TSC\n");
+    tsckhz = 1000000;
+  }
+  tscmult = div64((uint64)1000000 << TSCSHIFT, tsckhz);
+  tscboot = rdtsc();
+
+  timepage.tp.tsckhz = tsckhz;
+  timepage.tp.tscmult = tscmult;
+  timepage.tp.tscboot = tscboot;
+  cmostime(&timepage.tp.boot);
+}
+
+// Page to map at TIMEPAGE.
+char*
+clockpage(void)
+{
+  return timepage.page;
+}
+
+// Publish the tick count.  Called by cpu 0 once per tick.
+void
+clocktick(void)
+{
+  timepage.tp.ticks = ticks;
+}
+
+// Nanoseconds in c TSC cycles.
+uint64
+cyc2ns(uint64 c)
+{
+  uint hi = c >> 32;
+
+  return ((uint64)(uint)c * tscmult >> TSCSHIFT) +
+         ((uint64)hi * tscmult << (32 - TSCSHIFT));
+}
+
+// Nanoseconds since boot.
+uint64
+nsnow(void)
+{
+  return cyc2ns(rdtsc() - tscboot);
+}
@@ -0,0 +1,24 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "pinfoheader.h"
+
+// Print per-cpu idle residency, wakeup latency and balancing counts.
+int main(int argc, char *argv[])
+{
+  struct cpu_stat st[NCPU];
+  int i, n;
+
+  n = cpustat(st, NCPU);
+  if(n < 0){
+    printf(2, "cpustat: failed\n");
+    exit();
+  }
+  printf(1, "cpu idle%% wakeups avgwake maxwake ipis steals\n");
+  for(i = 0; i < n; i++)
+    printf(1, "%d %d.%d %d %d %d %d %d\n", st[i].cpu,
+           st[i].idle / 10, st[i].idle % 10, st[i].wakeups,
+           st[i].avgwake, st[i].maxwake, st[i].ipis, st[i].steals);
+  exit();
+}
@@ -6,3 +6,24 @@ struct rtcdate {
   uint month;
   uint year;
 };
+
+#define CLOCK_MONOTONIC 1   // Time since boot
+
+struct timespec {
+  uint sec;
+  uint nsec;
+};
+
+// Mapped read-only at TIMEPAGE in every address space, so
+// user code can read the time without entering the kernel.
+// ns since boot = (rdtsc() - tscboot) * tscmult >> TSCSHIFT.
+#define TSCSHIFT 22
+
+struct timepage {
+  volatile uint ticks;    // Timer interrupts since boot
+  uint tsckhz;            // TSC cycles per millisecond
+  uint tscmult;           // ns per TSC cycle << TSCSHIFT
+  uint pad;
+  uint64 tscboot;         // rdtsc() at boot
+  struct rtcdate boot;    // Wall clock (UTC) at boot
+};
@@ -10,6 +10,9 @@ struct sleeplock;
 struct stat;
 struct superblock;
 struct proc_stat;
+struct cpu_stat;
+struct mem_stat;
+struct traceev;
 
 // bio.c
 void            binit(void);
@@ -17,6 +20,15 @@ struct buf*     bread(uint, uint);
 void            brelse(struct buf*);
 void            bwrite(struct buf*);
 
+// clock.c
+void            clockinit(void);
+char*           clockpage(void);
+void            clocktick(void);
+uint64          cyc2ns(uint64);
+uint64          nsnow(void);
+extern uint64   tscboot;
+extern uint     tsckhz;
+
 // console.c
 void            consoleinit(void);
 void            cprintf(char*, ...);
@@ -29,12 +41,18 @@ int             exec(char*, char**);
 // file.c
 struct file*    filealloc(void);
 void            fileclose(struct file*);
+uint            filebytes(void);
 struct file*    filedup(struct file*);
 void            fileinit(void);
 int             fileread(struct file*, char*, int n);
 int             filestat(struct file*, struct stat*);
 int             filewrite(struct file*, char*, int n);
 
+// futex.c
+void            futexinit(void);
+int             futexwait(uint, uint);
+int             futexwake(uint, int);
+
 // fs.c
 void            readsb(int dev, struct superblock *sb);
 int             dirlink(struct inode*, char*, uint);
@@ -66,9 +84,14 @@ void            ioapicinit(void);
 
 // kalloc.c
 char*           kalloc(void);
+char*           kalloc_order(int);
 void            kfree(char*);
+void            kfree_order(char*, int);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
+void            kmemstat(struct mem_stat*);
+char*           kzalloc(void);
+int             kzfill(void);
 
 // kbd.c
 void            kbdintr(void);
@@ -79,7 +102,9 @@ int             lapicid(void);
 extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(void);
+void            lapicipi(int, int);
 void            lapicstartap(uchar, uint);
+void            lapictimer(int);
 void            microdelay(int);
 
 // log.c
@@ -98,16 +123,19 @@ void            picinit(void);
 
 // pipe.c
 int             pipealloc(struct file**, struct file**);
+uint            pipebytes(void);
 void            pipeclose(struct pipe*, int);
 int             piperead(struct pipe*, char*, int);
 int             pipewrite(struct pipe*, char*, int);
 
 //PAGEBREAK: 16
 // proc.c
+int             clone(uint, uint, uint);
 int             cpuid(void);
 void            exit(void);
 int             fork(void);
 int             growproc(int);
+int             join(uint*);
 int             kill(int);
 struct cpu*     mycpu(void);
 struct proc*    myproc();
@@ -120,10 +148,36 @@ void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             wait(void);
 void            wakeup(void*);
+int             wakeupn(void*, int);
 void            yield(void);
 int  			waitx(int*, int*);
 int 			set_priority(int, int);
+int             getaffinity(int);
+int             setaffinity(int, uint);
+void            prioboost(struct proc*, int);
+void            priorestore(struct proc*);
 int             getpinfo(struct proc_stat* , int);
+int             set_sched_class(int, int);
+int             settickets(int, int);
+
+// sched.c
+int             edfset(struct proc*, int, int);
+int             getcpustats(struct cpu_stat*, int);
+int             getscheduler(void);
+int             pbsprio(struct proc*);
+void            rebalance(void);
+void            runqaffine(struct proc*);
+struct cpu*     runqlock(struct proc*);
+struct proc*    runqpick(struct cpu*);
+void            runqput(struct proc*, struct cpu*);
+void            runqrenice(struct proc*);
+int             runqsteal(struct cpu*);
+void            runqwake(struct proc*);
+void            schedidle(struct cpu*);
+void            schedinit(void);
+int             schedpreempt(struct proc*, int);
+void            schedtick(void);
+int             setscheduler(int);
 
 // swtch.S
 void            swtch(struct context**, struct context*);
@@ -137,6 +191,13 @@ void            release(struct spinlock*);
 void            pushcli(void);
 void            popcli(void);
 
+// slab.c
+void*           kmalloc(uint);
+void            kmallocinit(void);
+void            kmallocstat(struct mem_stat*);
+void            kmfree(void*);
+uint            kmsize(uint);
+
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
 void            releasesleep(struct sleeplock*);
@@ -161,7 +222,14 @@ int             fetchstr(uint, char**);
 void            syscall(void);
 
 // timer.c
+int             sleep_until(uint);
 void            timerinit(void);
+void            timertick(void);
+
+// trace.c
+void            trace(int, struct proc*, int);
+int             tracedrain(struct traceev*, int);
+void            traceinit(void);
 
 // trap.c
 void            idtinit(void);
@@ -189,6 +257,9 @@ void            switchuvm(struct proc*);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
 void            clearpteu(pde_t *pgdir, char *uva);
+struct vmspace* vmcreate(pde_t*, uint);
+void            vmget(struct vmspace*);
+void            vmput(struct vmspace*);
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
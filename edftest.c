@@ -0,0 +1,64 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "pinfoheader.h"
+#include "sched.h"
+
+// usage: edftest
+// Checks that a process leaving EDF goes back to the class
+// it chose with set_sched_class(), including one chosen
+// while it was in EDF.
+
+// The class getpid() is queued in, after a sleep requeues it.
+int
+rqclass(void)
+{
+  struct proc_stat st;
+
+  sleep(1);
+  if(getpinfo(&st, getpid()) == 0)
+    return -2;
+  return st.policy;
+}
+
+void
+check(char *what, int want)
+{
+  int got;
+
+  if((got = rqclass()) != want){
+    printf(1, "edftest: %s: class %d, want %d\n", what, got, want);
+    exit();
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid;
+
+  pid = getpid();
+  if(set_sched_class(pid, SCHED_STRIDE) < 0){
+    printf(1, "edftest: set_sched_class failed\n");
+    exit();
+  }
+  check("stride", SCHED_STRIDE);
+  if(set_edf(10, 2) < 0){
+    printf(1, "edftest: set_edf failed\n");
+    exit();
+  }
+  check("edf", SCHED_EDF);
+  set_edf(0, 0);
+  check("after edf", SCHED_STRIDE);
+
+  set_edf(10, 2);
+  set_sched_class(pid, SCHED_CFS);
+  check("edf, cfs chosen", SCHED_EDF);
+  set_edf(0, 0);
+  check("after edf, cfs chosen", SCHED_CFS);
+
+  set_sched_class(pid, SCHED_DEFAULT);
+  printf(1, "edftest ok\n");
+  exit();
+}
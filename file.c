@@ -11,9 +11,12 @@
 #include "file.h"
 
 struct devsw devsw[NDEV];
+
+// Files come from kmalloc(); the lock guards their ref
+// counts and nfile, which is kept under NFILE.
 struct {
   struct spinlock lock;
-  struct file file[NFILE];
+  int nfile;
 } ftable;
 
 void
@@ -29,15 +32,22 @@ filealloc(void)
   struct file *f;
 
   acquire(&ftable.lock);
-  for(f = ftable.file; f < ftable.file + NFILE; f++){
-    if(f->ref == 0){
-      f->ref = 1;
-      release(&ftable.lock);
-      return f;
-    }
+  if(ftable.nfile == NFILE || (f = kmalloc(sizeof(*f))) == 0){
+    release(&ftable.lock);
+    return 0;
   }
+  ftable.nfile++;
   release(&ftable.lock);
-  return 0;
+  memset(f, 0, sizeof(*f));
+  f->ref = 1;
+  return f;
+}
+
+// Bytes of kernel memory an open file takes.
+uint
+filebytes(void)
+{
+  return kmsize(sizeof(struct file));
 }
 
 // Increment ref count for file f.
@@ -66,9 +76,9 @@ fileclose(struct file *f)
     return;
   }
   ff = *f;
-  f->ref = 0;
-  f->type = FD_NONE;
+  ftable.nfile--;
   release(&ftable.lock);
+  kmfree(f);
 
   if(ff.type == FD_PIPE)
     pipeclose(ff.pipe, ff.writable);
@@ -0,0 +1,89 @@
+// Futexes: sleep until a user memory word changes.
+//
+// A futex is named by the physical address of the word, so
+// threads sharing an address space find each other however
+// they got there.  Waiters sleep on that word's kernel
+// address; a hashed lock held across the check in
+// futexwait() and the wakeup in futexwake() means a wakeup
+// cannot slip in between a waiter reading the word and
+// going to sleep.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+
+static struct spinlock futexlock[NFUTEXQ];
+
+void
+futexinit(void)
+{
+  int i;
+
+  for(i = 0; i < NFUTEXQ; i++)
+    initlock(&futexlock[i], "futex");
+}
+
+// Kernel address of the user word at uva, or 0.
+static volatile uint*
+futexkey(uint uva)
+{
+  char *ka;
+
+  if(uva % sizeof(uint))
+    return 0;
+  if((ka = uva2ka(myproc()->pgdir, (char*)PGROUNDDOWN(uva))) == 0)
+    return 0;
+  return (volatile uint*)(ka + uva % PGSIZE);
+}
+
+static struct spinlock*
+futexlockof(volatile uint *key)
+{
+  return &futexlock[((uint)key * 2654435761U >> 16) % NFUTEXQ];
+}
+
+// If the word at uva still holds val, sleep until
+// futexwake() on it.  Returns 0 after sleeping, -1 if the
+// word had changed or uva is bad.  Wakeups may be spurious.
+int
+futexwait(uint uva, uint val)
+{
+  volatile uint *key;
+  struct spinlock *lk;
+
+  if((key = futexkey(uva)) == 0)
+    return -1;
+  lk = futexlockof(key);
+  acquire(lk);
+  if(*key != val){
+    release(lk);
+    return -1;
+  }
+  sleep((void*)key, lk);
+  release(lk);
+  return 0;
+}
+
+// Wake up to n processes waiting on the word at uva, all
+// of them if n < 0.  Returns how many woke, or -1 if uva
+// is bad.
+int
+futexwake(uint uva, int n)
+{
+  volatile uint *key;
+  struct spinlock *lk;
+  int woke;
+
+  if((key = futexkey(uva)) == 0)
+    return -1;
+  lk = futexlockof(key);
+  acquire(lk);
+  woke = wakeupn((void*)key, n);
+  release(lk);
+  return woke;
+}
@@ -0,0 +1,207 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "x86.h"
+#include "pinfoheader.h"
+
+// usage: futexbench [threads]
+// Compares ways for threads to block on each other:
+//   lock      threads (default the number of cpus, at least
+//             2) each take a lock ITERS times to bump a
+//             shared counter, with a spin lock, the futex
+//             mutex and a pipe holding one token byte
+//   pingpong  two threads hand a turn back and forth ROUNDS
+//             times, with the futex condvar and two pipes
+// Prints the wall time and ns per lock or handoff.
+
+#define ITERS   20000
+#define ROUNDS  2000
+#define MAXTHR  (NPROC/2)
+
+enum { SPIN, MUTEX, PIPE };
+
+char *kinds[] = {
+[SPIN]  "spin",
+[MUTEX] "mutex",
+[PIPE]  "pipe",
+};
+
+int kind;
+struct spin slk;
+struct mutex mlk;
+struct cond cv;
+int lockfd[2];
+int pingfd[2], pongfd[2];
+volatile uint counter;
+volatile int turn;
+
+uint64
+nsnow(void)
+{
+  return tsc2ns(rdtsc());
+}
+
+void
+lock(void)
+{
+  char c;
+
+  switch(kind){
+  case SPIN:
+    spin_lock(&slk);
+    break;
+  case MUTEX:
+    mutex_lock(&mlk);
+    break;
+  case PIPE:
+    read(lockfd[0], &c, 1);
+    break;
+  }
+}
+
+void
+unlock(void)
+{
+  char c = 0;
+
+  switch(kind){
+  case SPIN:
+    spin_unlock(&slk);
+    break;
+  case MUTEX:
+    mutex_unlock(&mlk);
+    break;
+  case PIPE:
+    write(lockfd[1], &c, 1);
+    break;
+  }
+}
+
+void
+locker(void *arg)
+{
+  int i;
+
+  for(i = 0; i < ITERS; i++){
+    lock();
+    counter++;
+    unlock();
+  }
+}
+
+void
+locktest(int k, int nthr)
+{
+  uint64 t0, ns;
+  char c = 0;
+  int i;
+
+  kind = k;
+  counter = 0;
+  spin_init(&slk);
+  mutex_init(&mlk);
+  if(pipe(lockfd) < 0){
+    printf(2, "futexbench: pipe failed\n");
+    exit();
+  }
+  write(lockfd[1], &c, 1);
+
+  t0 = nsnow();
+  for(i = 0; i < nthr; i++)
+    if(thread_create(locker, 0) < 0){
+      printf(2, "futexbench: thread_create failed\n");
+      exit();
+    }
+  for(i = 0; i < nthr; i++)
+    thread_join();
+  ns = nsnow() - t0;
+
+  close(lockfd[0]);
+  close(lockfd[1]);
+  if(counter != nthr * ITERS)
+    printf(2, "futexbench: %s lost updates\n", kinds[k]);
+  printf(1, "lock %s: %d threads %d us, %d ns per lock\n", kinds[k], nthr,
+         (uint)div64(ns, 1000), (uint)div64(ns, nthr * ITERS));
+}
+
+void
+ponger(void *arg)
+{
+  int me = (int)arg;
+  int i;
+  char c = 0;
+
+  for(i = 0; i < ROUNDS; i++){
+    if(kind == PIPE){
+      if(me == 0){
+        write(pingfd[1], &c, 1);
+        read(pongfd[0], &c, 1);
+      } else {
+        read(pingfd[0], &c, 1);
+        write(pongfd[1], &c, 1);
+      }
+      continue;
+    }
+    mutex_lock(&mlk);
+    while(turn != me)
+      cond_wait(&cv, &mlk);
+    turn = !me;
+    cond_signal(&cv);
+    mutex_unlock(&mlk);
+  }
+}
+
+void
+pingpong(int k)
+{
+  uint64 t0, ns;
+
+  kind = k;
+  turn = 0;
+  mutex_init(&mlk);
+  cond_init(&cv);
+  if(pipe(pingfd) < 0 || pipe(pongfd) < 0){
+    printf(2, "futexbench: pipe failed\n");
+    exit();
+  }
+
+  t0 = nsnow();
+  if(thread_create(ponger, (void*)0) < 0 ||
+     thread_create(ponger, (void*)1) < 0){
+    printf(2, "futexbench: thread_create failed\n");
+    exit();
+  }
+  thread_join();
+  thread_join();
+  ns = nsnow() - t0;
+
+  close(pingfd[0]);
+  close(pingfd[1]);
+  close(pongfd[0]);
+  close(pongfd[1]);
+  printf(1, "pingpong %s: %d us, %d ns per handoff\n",
+         k == PIPE ? "pipe" : "condvar",
+         (uint)div64(ns, 1000), (uint)div64(ns, 2 * ROUNDS));
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct cpu_stat cs[NCPU];
+  int k, nthr;
+
+  nthr = cpustat(cs, NCPU);
+  if(argc > 1)
+    nthr = atoi(argv[1]);
+  if(nthr < 2)
+    nthr = 2;
+  if(nthr > MAXTHR)
+    nthr = MAXTHR;
+
+  for(k = SPIN; k <= PIPE; k++)
+    locktest(k, nthr);
+  pingpong(MUTEX);
+  pingpong(PIPE);
+  exit();
+}
@@ -4,9 +4,20 @@
 #include "stat.h"
 #include "user.h"
 #include "fcntl.h"
+#include "sched.h"
 
 char *argv[] = { "sh", 0 };
 
+char *policies[] = {
+[SCHED_ROUND_ROBIN] "Round Robin",
+[SCHED_FCFS]        "FCFS",
+[SCHED_PBS]         "Priority Based Sceduling",
+[SCHED_MLFQ]        "MLFQ",
+[SCHED_CFS]         "CFS",
+[SCHED_STRIDE]      "Stride",
+[SCHED_LOTTERY]     "Lottery",
+};
+
 int
 main(void)
 {
@@ -19,21 +30,7 @@ main(void)
   dup(0);  // stdout
   dup(0);  // stderr
 
-  #ifdef ROUND_ROBIN
-    printf(1, "Scheduler policy: Round Robin\n");
-  #else
-  #ifdef FCFS
-    printf(1, "Scheduler policy: FCFS\n");
-  #else
-  #ifdef PBS
-    printf(1, "Scheduler policy: Priority Based Sceduling\n");
-  #else
-  #ifdef MLFQ
-    printf(1, "Scheduler policy: MLFQ\n");
-  #endif
-  #endif 
-  #endif
-  #endif
+  printf(1, "Scheduler policy: %s\n", policies[get_scheduler()]);
   for(;;){
     printf(1, "init: starting sh\n");
     pid = fork();
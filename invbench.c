@@ -0,0 +1,130 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "param.h"
+#include "x86.h"
+#include "sched.h"
+#include "pinfoheader.h"
+
+// usage: invbench [hogs]
+// Priority inversion under PBS.  A low priority process
+// keeps rewriting a file too big for the buffer cache, so
+// it holds the inode lock across disk reads; hogs (default
+// 2) of middle priority spin for HOGTICKS; and a high
+// priority process stats the same file once a tick, which
+// needs that lock.  Reports the slowest fstat and the time
+// the high process spent blocked on the low one.  Compare
+// a kernel built with PI=0.
+
+#define LOW      90
+#define MID      50
+#define HIGH     10
+#define HOGTICKS 300
+#define NSTAT    100
+
+char *file = "invbench.tmp";
+
+int
+spawn(int pri)
+{
+  int pid;
+
+  pid = fork();
+  if(pid < 0){
+    printf(2, "invbench: fork failed\n");
+    exit();
+  }
+  if(pid == 0)
+    set_priority(pri, getpid());
+  return pid;
+}
+
+void
+low(void)
+{
+  char buf[512];
+  int fd;
+
+  memset(buf, 'x', sizeof(buf));
+  for(;;){
+    if((fd = open(file, O_RDWR)) < 0)
+      exit();
+    while(write(fd, buf, sizeof(buf)) == sizeof(buf))
+      ;
+    close(fd);
+  }
+}
+
+void
+hog(void)
+{
+  uint end = uptime() + HOGTICKS;
+
+  while(uptime() < end)
+    ;
+  exit();
+}
+
+void
+high(void)
+{
+  struct proc_stat ps;
+  struct stat st;
+  uint64 t0;
+  uint us, max;
+  int i, fd;
+
+  if((fd = open(file, O_RDONLY)) < 0){
+    printf(2, "invbench: open %s failed\n", file);
+    exit();
+  }
+  max = 0;
+  for(i = 0; i < NSTAT; i++){
+    sleep(1);
+    t0 = rdtsc();
+    fstat(fd, &st);
+    us = div64(tsc2ns(rdtsc() - t0), 1000);
+    if(us > max)
+      max = us;
+  }
+  close(fd);
+  getpinfo(&ps, getpid());
+  printf(1, "invbench: %d fstats, slowest %d us, inverted %d us\n",
+         NSTAT, max, ps.inversion);
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, nhog, old, lowpid;
+
+  nhog = 2;
+  if(argc > 1)
+    nhog = atoi(argv[1]);
+  if(nhog < 0 || nhog > NPROC - 8)
+    nhog = 2;
+
+  old = set_scheduler(SCHED_PBS);
+  // Stay above the hogs to start the others.
+  set_priority(HIGH - 1, getpid());
+
+  close(open(file, O_CREATE|O_RDWR));
+  if((lowpid = spawn(LOW)) == 0)
+    low();
+  sleep(2);
+  for(i = 0; i < nhog; i++)
+    if(spawn(MID) == 0)
+      hog();
+  if(spawn(HIGH) == 0)
+    high();
+
+  for(i = 0; i < nhog + 1; i++)
+    wait();
+  kill(lowpid);
+  wait();
+  unlink(file);
+  set_scheduler(old);
+  exit();
+}
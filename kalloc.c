@@ -1,6 +1,22 @@
 // Physical memory allocator, intended to allocate
 // memory for user processes, kernel stacks, page table pages,
-// and pipe buffers. Allocates 4096-byte pages.
+// and pipe buffers.
+//
+// A binary buddy allocator hands out blocks of 2^order pages,
+// order up to MAXORDER, aligned to their size.  Freeing a
+// block merges it with its buddy whenever that is free too.
+// pgfree[] records, for each physical page, order+1 if a free
+// block starts there, so finding the buddy is a lookup.
+//
+// kalloc() and kfree() are the order 0 case.  Each cpu keeps
+// a magazine of free pages in front of the buddy lists, and
+// only takes kmem.lock to move KBATCH pages at a time between
+// the two.  Pages sitting in other cpus' magazines (at most
+// KMAG each) are not seen by a cpu that runs out.
+//
+// Freed pages are only filled with junk in KPOISON builds.
+// Idle cpus instead zero up to KZPOOL pages ahead of time,
+// for kzalloc() callers that need a clean page.
 
 #include "types.h"
 #include "defs.h"
@@ -8,21 +24,47 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "spinlock.h"
+#include "pinfoheader.h"
+
+#define KBATCH 16          // pages moved to or from kmem at once
+#define KMAG   (2*KBATCH)  // most pages a magazine holds
+#define KZPOOL 64          // most pre-zeroed pages
+#define NPHYSPG (PHYSTOP/PGSIZE)
 
 void freerange(void *vstart, void *vend);
+static char* kzpop(void);
 extern char end[]; // first address after kernel loaded from ELF file
                    // defined by the kernel linker script in kernel.ld
 
 struct run {
   struct run *next;
+  struct run *prev;  // buddy lists only
 };
 
 struct {
   struct spinlock lock;
   int use_lock;
-  struct run *freelist;
+  uint npages;                         // pages given by freerange()
+  struct run *freelist[MAXORDER+1];    // free blocks by order
+  uint nfree[MAXORDER+1];
 } kmem;
 
+static uchar pgfree[NPHYSPG];
+
+// A cpu's magazine.  Only touched by its own cpu with
+// interrupts off.
+static struct kmag {
+  int n;
+  struct run *freelist;
+} kmags[NCPU];
+
+// Pages zeroed by idle cpus.
+struct {
+  struct spinlock lock;
+  int n;
+  struct run *freelist;
+} kzero;
+
 // Initialization happens in two phases.
 // 1. main() calls kinit1() while still using entrypgdir to place just
 // the pages mapped by entrypgdir on free list.
@@ -32,6 +74,7 @@ void
 kinit1(void *vstart, void *vend)
 {
   initlock(&kmem.lock, "kmem");
+  initlock(&kzero.lock, "kzero");
   kmem.use_lock = 0;
   freerange(vstart, vend);
 }
@@ -48,9 +91,81 @@ freerange(void *vstart, void *vend)
 {
   char *p;
   p = (char*)PGROUNDUP((uint)vstart);
-  for(; p + PGSIZE <= (char*)vend; p += PGSIZE)
+  for(; p + PGSIZE <= (char*)vend; p += PGSIZE){
     kfree(p);
+    kmem.npages++;
+  }
+}
+
+// Buddy lists.  Caller must hold kmem.lock once it is in use.
+
+static void
+pushfree(struct run *r, int order)
+{
+  r->prev = 0;
+  r->next = kmem.freelist[order];
+  if(r->next)
+    r->next->prev = r;
+  kmem.freelist[order] = r;
+  kmem.nfree[order]++;
+  pgfree[V2P(r) / PGSIZE] = order + 1;
+}
+
+static void
+unlinkfree(struct run *r, int order)
+{
+  if(r->prev)
+    r->prev->next = r->next;
+  else
+    kmem.freelist[order] = r->next;
+  if(r->next)
+    r->next->prev = r->prev;
+  kmem.nfree[order]--;
+  pgfree[V2P(r) / PGSIZE] = 0;
+}
+
+// Take a free block of the given order, splitting a
+// larger one if there is none.
+static char*
+buddyalloc(int order)
+{
+  struct run *r;
+  int k;
+
+  for(k = order; k <= MAXORDER && kmem.freelist[k] == 0; k++)
+    ;
+  if(k > MAXORDER)
+    return 0;
+  r = kmem.freelist[k];
+  unlinkfree(r, k);
+  // Keep the lower half, free the upper.
+  while(k > order){
+    k--;
+    pushfree((struct run*)((char*)r + (PGSIZE << k)), k);
+  }
+  return (char*)r;
 }
+
+// Free a block, merging it with its buddy while that is a
+// free block of the same order.
+static void
+buddyfree(char *v, int order)
+{
+  uint pn, bn;
+
+  pn = V2P(v) / PGSIZE;
+  if(pgfree[pn])
+    panic("kfree: already free");
+  for(; order < MAXORDER; order++){
+    bn = pn ^ (1 << order);
+    if(bn >= NPHYSPG || pgfree[bn] != order + 1)
+      break;
+    unlinkfree((struct run*)P2V(bn * PGSIZE), order);
+    pn &= ~(1 << order);
+  }
+  pushfree((struct run*)P2V(pn * PGSIZE), order);
+}
+
 //PAGEBREAK: 21
 // Free the page of physical memory pointed at by v,
 // which normally should have been returned by a
@@ -59,21 +174,76 @@ freerange(void *vstart, void *vend)
 void
 kfree(char *v)
 {
-  struct run *r;
+  struct run *r, *first;
+  struct kmag *m;
+  int i;
 
   if((uint)v % PGSIZE || v < end || V2P(v) >= PHYSTOP)
     panic("kfree");
 
+#if KPOISON
   // Fill with junk to catch dangling refs.
   memset(v, 1, PGSIZE);
+#endif
 
-  if(kmem.use_lock)
-    acquire(&kmem.lock);
   r = (struct run*)v;
-  r->next = kmem.freelist;
-  kmem.freelist = r;
-  if(kmem.use_lock)
+  if(!kmem.use_lock){
+    // Still booting on one cpu; no magazines yet.
+    buddyfree(v, 0);
+    return;
+  }
+
+  pushcli();
+  m = &kmags[cpuid()];
+  r->next = m->freelist;
+  m->freelist = r;
+  if(++m->n == KMAG){
+    // Give the older half back.
+    for(i = 1, r = m->freelist; i < KMAG - KBATCH; i++)
+      r = r->next;
+    first = r->next;
+    r->next = 0;
+    acquire(&kmem.lock);
+    while((r = first) != 0){
+      first = r->next;
+      buddyfree((char*)r, 0);
+    }
     release(&kmem.lock);
+    m->n -= KBATCH;
+  }
+  popcli();
+}
+
+// Take a page from this cpu's magazine or the buddy lists,
+// but not from the zeroed pool.
+static char*
+kalloc1(void)
+{
+  struct run *r;
+  struct kmag *m;
+
+  if(!kmem.use_lock)
+    return buddyalloc(0);
+
+  pushcli();
+  m = &kmags[cpuid()];
+  if(m->n == 0){
+    // Refill with up to KBATCH pages.
+    acquire(&kmem.lock);
+    while(m->n < KBATCH && (r = (struct run*)buddyalloc(0)) != 0){
+      r->next = m->freelist;
+      m->freelist = r;
+      m->n++;
+    }
+    release(&kmem.lock);
+  }
+  r = m->freelist;
+  if(r){
+    m->freelist = r->next;
+    m->n--;
+  }
+  popcli();
+  return (char*)r;
 }
 
 // Allocate one 4096-byte page of physical memory.
@@ -81,16 +251,123 @@ kfree(char *v)
 // Returns 0 if the memory cannot be allocated.
 char*
 kalloc(void)
+{
+  char *v;
+
+  if((v = kalloc1()) == 0)
+    v = kzpop();  // last resort
+  return v;
+}
+
+// Allocate 2^order physically contiguous pages, aligned
+// to their size.  Returns 0 if there is no such block.
+char*
+kalloc_order(int order)
+{
+  char *v;
+
+  if(order < 0 || order > MAXORDER)
+    return 0;
+  if(order == 0)
+    return kalloc();
+  acquire(&kmem.lock);
+  v = buddyalloc(order);
+  release(&kmem.lock);
+  return v;
+}
+
+// Free a block from kalloc_order(order).
+void
+kfree_order(char *v, int order)
+{
+  if(order == 0){
+    kfree(v);
+    return;
+  }
+  if(order < 0 || order > MAXORDER || V2P(v) % (PGSIZE << order) ||
+     v < end || V2P(v) + (PGSIZE << order) > PHYSTOP)
+    panic("kfree_order");
+#if KPOISON
+  memset(v, 1, PGSIZE << order);
+#endif
+  acquire(&kmem.lock);
+  buddyfree(v, order);
+  release(&kmem.lock);
+}
+
+// Fill in st with the free blocks of each order and the
+// pages held in front of the buddy lists.
+void
+kmemstat(struct mem_stat *st)
+{
+  int k;
+
+  memset(st, 0, sizeof(*st));
+  st->total = kmem.npages;
+  acquire(&kmem.lock);
+  for(k = 0; k <= MAXORDER; k++){
+    st->blocks[k] = kmem.nfree[k];
+    st->free += kmem.nfree[k] << k;
+  }
+  release(&kmem.lock);
+  for(k = 0; k < NCPU; k++)
+    st->cached += kmags[k].n;
+  st->cached += kzero.n;
+}
+
+// Take a page from the zeroed pool, or return 0.
+static char*
+kzpop(void)
 {
   struct run *r;
 
-  if(kmem.use_lock)
-    acquire(&kmem.lock);
-  r = kmem.freelist;
+  acquire(&kzero.lock);
+  r = kzero.freelist;
+  if(r){
+    kzero.freelist = r->next;
+    kzero.n--;
+  }
+  release(&kzero.lock);
   if(r)
-    kmem.freelist = r->next;
-  if(kmem.use_lock)
-    release(&kmem.lock);
+    r->next = 0;  // the only word that wasn't zero
   return (char*)r;
 }
 
+// Allocate one zeroed page.
+char*
+kzalloc(void)
+{
+  char *v;
+
+  if((v = kzpop()) == 0 && (v = kalloc()) != 0)
+    memset(v, 0, PGSIZE);
+  return v;
+}
+
+// Zero a free page for kzalloc().  Called by idle cpus;
+// returns 0 once the pool is full or memory has run out.
+int
+kzfill(void)
+{
+  struct run *r;
+
+  // Other cpus idle here while kinit2() is still filling
+  // the buddy lists without the lock.
+  if(!kmem.use_lock || kzero.n >= KZPOOL)
+    return 0;
+  if((r = (struct run*)kalloc1()) == 0)
+    return 0;
+  memset(r, 0, PGSIZE);
+  acquire(&kzero.lock);
+  if(kzero.n < KZPOOL){
+    r->next = kzero.freelist;
+    kzero.freelist = r;
+    kzero.n++;
+    r = 0;
+  }
+  release(&kzero.lock);
+  if(r)
+    kfree((char*)r);
+  return 1;
+}
+
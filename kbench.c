@@ -0,0 +1,106 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "pinfoheader.h"
+
+// usage: kbench [procs]
+// Page allocator throughput.  Starts procs workers (default
+// one per cpu), each pinned to its own cpu, which together
+//   sbrk  grow by NPAGE pages and shrink back, ROUNDS times
+//   fork  fork a child that exits at once and wait, NFORK times
+// and prints one CSV line per workload (see CSVHDR) for
+// "make bench BENCH=kbench" to collect.  ops are pages
+// allocated and freed for sbrk, forks for fork.
+
+#define NPAGE   64
+#define ROUNDS  200
+#define NFORK   100
+
+#define CSVHDR "cpus,workload,procs,ops,elapsed_us,ops_per_sec"
+
+enum { SBRK, FORK };
+
+char *workloads[] = {
+[SBRK] "sbrk",
+[FORK] "fork",
+};
+
+int ncpu;
+
+void
+work(int w)
+{
+  int i;
+
+  for(i = 0; i < (w == SBRK ? ROUNDS : NFORK); i++){
+    if(w == SBRK){
+      if(sbrk(NPAGE*PGSIZE) == (char*)-1){
+        printf(2, "kbench: sbrk failed\n");
+        break;
+      }
+      sbrk(-NPAGE*PGSIZE);
+    } else {
+      if(fork() == 0)
+        exit();
+      wait();
+    }
+  }
+  exit();
+}
+
+void
+run(int w, int nproc)
+{
+  uint64 t0, us;
+  uint ops;
+  int i, fd[2];
+  char c;
+
+  if(pipe(fd) < 0){
+    printf(2, "kbench: pipe failed\n");
+    exit();
+  }
+  for(i = 0; i < nproc; i++){
+    if(fork() == 0){
+      sched_setaffinity(getpid(), 1 << (i % ncpu));
+      // Start together when the parent closes fd[1].
+      close(fd[1]);
+      read(fd[0], &c, 1);
+      work(w);
+    }
+  }
+  close(fd[0]);
+  sleep(1);
+  t0 = rdtsc();
+  close(fd[1]);
+  for(i = 0; i < nproc; i++)
+    wait();
+  us = div64(tsc2ns(rdtsc() - t0), 1000);
+
+  ops = nproc * (w == SBRK ? ROUNDS * NPAGE : NFORK);
+  printf(1, "CSV,%d,%s,%d,%d,%d,%d\n", ncpu, workloads[w], nproc, ops,
+         (uint)us, us ? (uint)div64((uint64)ops * 1000000, us) : 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct cpu_stat cs[NCPU];
+  int nproc;
+
+  ncpu = cpustat(cs, NCPU);
+  nproc = ncpu;
+  if(argc > 1 && atoi(argv[1]) > 0)
+    nproc = atoi(argv[1]);
+  if(nproc > NPROC/4)
+    nproc = NPROC/4;
+
+  printf(1, "%s\n", CSVHDR);
+  run(SBRK, nproc);
+  run(FORK, nproc);
+  printf(1, "kbench: done\n");
+  exit();
+}
@@ -123,6 +123,24 @@ microdelay(int us)
 #define CMOS_PORT    0x70
 #define CMOS_RETURN  0x71
 
+// Send interrupt vector to the cpu with the given APIC id.
+// Caller must have interrupts off.
+void
+lapicipi(int apicid, int vector)
+{
+  lapicw(ICRHI, apicid<<24);
+  lapicw(ICRLO, FIXED | ASSERT | vector);
+  while(lapic[ICRLO] & DELIVS)
+    ;
+}
+
+// Stop (on == 0) or restart this cpu's timer interrupt.
+void
+lapictimer(int on)
+{
+  lapicw(TIMER, (on ? 0 : MASKED) | PERIODIC | (T_IRQ0 + IRQ_TIMER));
+}
+
 // Start additional processor running entry code at addr.
 // See Appendix B of MultiProcessor Specification.
 void
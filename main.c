@@ -3,6 +3,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "x86.h"
 
@@ -19,7 +20,7 @@ main(void)
 {
   for(int i=0; i<5; i++)
   {
-    front[i] = -1, rear[i] = -1, qSize[i] = 0, qticks[i] = (1<<i);
+    qticks[i] = (1<<i);
   }
   
   kinit1(end, P2V(4*1024*1024)); // phys page allocator
@@ -31,8 +32,13 @@ main(void)
   ioapicinit();    // another interrupt controller
   consoleinit();   // console hardware
   uartinit();      // serial port
+  clockinit();     // calibrate TSC
   pinit();         // process table
   tvinit();        // trap vectors
+  timerinit();     // timer wheel
+  traceinit();     // scheduler trace
+  futexinit();     // futex locks
+  kmallocinit();   // small object caches
   binit();         // buffer cache
   fileinit();      // file table
   ideinit();       // disk 
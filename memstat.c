@@ -0,0 +1,41 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "pinfoheader.h"
+
+// usage: memstat
+// Prints the page allocator's free blocks of each order and
+// how fragmented free memory is: for each order, the percent
+// of free pages in blocks too small to satisfy it.  Then the
+// kmalloc size classes, and what a pipe and an open file
+// take from them.
+
+int
+main(int argc, char *argv[])
+{
+  struct mem_stat st;
+  uint small, pages;
+  int k;
+
+  if(memstat(&st) < 0){
+    printf(2, "memstat: failed\n");
+    exit();
+  }
+  printf(1, "%d pages, %d free, %d cached\n", st.total, st.free, st.cached);
+  printf(1, "order  blocks  pages  unusable%%\n");
+  small = 0;
+  for(k = 0; k <= MAXORDER; k++){
+    pages = st.blocks[k] << k;
+    printf(1, "%d %d %d %d\n", k, st.blocks[k], pages,
+           st.free ? small * 100 / st.free : 0);
+    small += pages;
+  }
+
+  printf(1, "kmalloc  slabs  objects\n");
+  for(k = 0; k < NKMCLASS; k++)
+    printf(1, "%d %d %d\n", st.kmsize[k], st.kmslabs[k], st.kmobjs[k]);
+  printf(1, "pipe %d bytes (a page before), file %d bytes (only while open)\n",
+         st.pipebytes, st.filebytes);
+  exit();
+}
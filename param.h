@@ -1,6 +1,15 @@
 #define NPROC        64  // maximum number of processes
+#define NPIDHASH     64  // pid hash buckets, a power of 2
+#define NSLEEPQ      64  // sleep channel hash buckets
+#define NFUTEXQ      16  // futex lock hash buckets
 #define KSTACKSIZE 4096  // size of per-process kernel stack
+#define MAXORDER     10  // largest kalloc_order(), 4MB
 #define NCPU          8  // maximum number of CPUs
+#define BALANCEINT   10  // timer ticks between run queue rebalances
+#define NQUEUE        5  // MLFQ priority levels
+#define NPRIO       128  // PBS priority levels; higher priorities share the last
+#define NSCHED        8  // scheduling policies (see sched.h)
+#define EDFLIMIT    900  // EDF admission limit, thousandths of a cpu
 #define NOFILE       16  // open files per process
 #define NFILE       100  // open files per system
 #define NINODE       50  // maximum number of active i-nodes
@@ -10,5 +19,5 @@
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
-#define FSSIZE       1000  // size of file system in blocks
+#define FSSIZE       3000  // size of file system in blocks
 
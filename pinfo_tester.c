@@ -3,6 +3,7 @@
 #include "stat.h"
 #include "user.h"
 #include "fcntl.h"
+#include "param.h"
 #include "pinfoheader.h"
 
 int main(int argc, char *argv[]) {
@@ -24,6 +25,17 @@ int main(int argc, char *argv[]) {
             for(int i=0; i<5; i++) {
                 printf(1, "Number of ticks spent in queue %d: %d\n", i+1, p.ticks[i]);
             }
+            printf(1, "migrations: %d\n", p.migrations);
+            printf(1, "last cpu: %d\n", p.cpu);
+            printf(1, "affinity: 0x%x\n", p.affinity);
+            printf(1, "steals: %d\n", p.steals);
+            printf(1, "tickets: %d\n", p.tickets);
+            printf(1, "pass: %d\n", p.pass);
+            printf(1, "share: %d%%\n", p.share);
+            printf(1, "deadline misses: %d\n", p.misses);
+            printf(1, "run/wait/sleep: %d/%d/%d us\n", p.rtime, p.wtime, p.stime);
+            printf(1, "priority: %d\n", p.priority);
+            printf(1, "priority inversion: %d us\n", p.inversion);
 
         }
     }
@@ -4,4 +4,44 @@ struct proc_stat{
   int num_run;
   int current_queue;
   int ticks[5];
-};
\ No newline at end of file
+  int migrations;
+  int cpu;      // cpu it last ran on (or is queued on)
+  uint affinity; // cpus it may run on
+  int steals;
+  int policy;
+  int tickets;
+  uint pass;
+  int share;    // percent of one cpu since the process started
+  int misses;   // EDF deadlines missed
+  uint rtime;   // microseconds running,
+  uint wtime;   //   runnable,
+  uint stime;   //   and sleeping
+  int priority; // current, including any inherited
+  uint inversion; // us blocked on sleeplocks held by worse priorities
+};
+
+struct cpu_stat{
+  int cpu;
+  int idle;       // per mille of time halted since boot
+  uint wakeups;   // woken processes run on this cpu
+  uint avgwake;   // mean cycles from wakeup to running
+  uint maxwake;   // longest cycles from wakeup to running
+  uint ipis;      // reschedule IPIs received
+  uint steals;    // processes taken from other run queues
+  uint ticks;     // timer interrupts
+  uint tickcyc;   // cycles spent in them (low 32 bits)
+};
+
+#define NKMCLASS 7  // kmalloc size classes, 32 to 2048 bytes
+
+struct mem_stat{
+  uint total;     // pages the allocator manages
+  uint free;      // pages in free buddy blocks
+  uint cached;    // free pages in per-cpu magazines and the zeroed pool
+  uint blocks[MAXORDER+1]; // free blocks of 2^i pages
+  uint kmsize[NKMCLASS];   // kmalloc size class,
+  uint kmslabs[NKMCLASS];  //   pages of slabs it has,
+  uint kmobjs[NKMCLASS];   //   and objects in use
+  uint pipebytes; // kernel memory per pipe
+  uint filebytes; //   and per open file
+};
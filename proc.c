@@ -4,15 +4,40 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "x86.h"
-#include "proc.h"
 #include "spinlock.h"
+#include "proc.h"
 #include "pinfoheader.h"
+#include "sched.h"
+#include "trace.h"
 
+// ptable.lock guards pid allocation, UNUSED/EMBRYO slots,
+// the pid hash and the parent and child links.  Everything
+// the scheduler touches is guarded by the per-process lock
+// and the per-CPU run queues.
 struct {
   struct spinlock lock;
   struct proc proc[NPROC];
+  struct proc *pidhash[NPIDHASH];  // Live processes by pid
+  struct proc *free;               // UNUSED slots
 } ptable;
 
+#define PIDHASH(pid) ((pid) & (NPIDHASH-1))
+
+// Sleeping processes, hashed by channel.  A process is on
+// its channel's queue exactly while it is SLEEPING.  Lock
+// order is ptable.lock, then a queue's lock, then p->lock.
+struct sleepq {
+  struct spinlock lock;
+  struct proc *head;
+};
+static struct sleepq sleepq[NSLEEPQ];
+
+static struct sleepq*
+sleepqof(void *chan)
+{
+  return &sleepq[((uint)chan * 2654435761U >> 16) % NSLEEPQ];
+}
+
 static struct proc *initproc;
 
 int nextpid = 1;
@@ -22,10 +47,61 @@ extern void trapret(void);
 
 static void wakeup1(void *chan);
 
+// Return the process with the given pid, or 0.
+// Caller must hold ptable.lock.
+static struct proc*
+findproc(int pid)
+{
+  struct proc *p;
+
+  for(p = ptable.pidhash[PIDHASH(pid)]; p; p = p->hnext)
+    if(p->pid == pid)
+      return p;
+  return 0;
+}
+
+// Free p's memory, take it out of the pid hash and put the
+// slot back on the free list.  p must be off its parent's
+// child list.  Caller must hold ptable.lock.
+static void
+freeproc(struct proc *p)
+{
+  struct proc **pp;
+
+  for(pp = &ptable.pidhash[PIDHASH(p->pid)]; *pp != p; pp = &(*pp)->hnext)
+    ;
+  *pp = p->hnext;
+  if(p->kstack)
+    kfree(p->kstack);
+  p->kstack = 0;
+  if(p->vm)
+    vmput(p->vm);
+  p->vm = 0;
+  p->pgdir = 0;
+  p->pid = 0;
+  p->parent = 0;
+  p->name[0] = 0;
+  p->killed = 0;
+  p->state = UNUSED;
+  p->hnext = ptable.free;
+  ptable.free = p;
+}
+
 void
 pinit(void)
 {
+  struct proc *p;
+  struct sleepq *q;
+
   initlock(&ptable.lock, "ptable");
+  for(p = &ptable.proc[NPROC-1]; p >= ptable.proc; p--){
+    initlock(&p->lock, "proc");
+    p->hnext = ptable.free;
+    ptable.free = p;
+  }
+  for(q = sleepq; q < &sleepq[NSLEEPQ]; q++)
+    initlock(&q->lock, "sleepq");
+  schedinit();
 }
 
 // Must be called with interrupts disabled
@@ -80,40 +156,60 @@ allocproc(void)
 
   acquire(&ptable.lock);
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == UNUSED)
-      goto found;
-
-  release(&ptable.lock);
-  return 0;
+  if((p = ptable.free) == 0){
+    release(&ptable.lock);
+    return 0;
+  }
+  ptable.free = p->hnext;
 
-found:
   p->state = EMBRYO;
   p->pid = nextpid++;
+  p->hnext = ptable.pidhash[PIDHASH(p->pid)];
+  ptable.pidhash[PIDHASH(p->pid)] = p;
+  p->parent = 0;
+  p->child = 0;
+  p->sibling = 0;
+  p->vm = 0;
+  p->pgdir = 0;
+  p->kstack = 0;
   p->startTime = ticks;
   p->runTime = 0;                               // default value
   p->endTime = 0;                               // default value
-  p->wait_queue_time = 0;                       // default value
+  p->enqticks = 0;
   p->priority = 60;                             // default priority
+  p->inhpri = NPRIO;
+  p->nsleeplock = 0;
+  p->invtsc = 0;
   p->queue = 0;                                 // default queue for MLFQ Scheduling
   p->curTime = 0;
   p->num_run = 0;
+  p->policy = SCHED_DEFAULT;
+  p->rqclass = SCHED_DEFAULT;
+  p->cpu = 0;
+  p->migrations = 0;
+  p->steals = 0;
+  p->hidx = -1;
+  p->vruntime = 0;
+  p->tickets = DEFTICKETS;
+  p->affinity = ~0;
+  p->pass = 0;
+  p->period = p->budget = p->left = 0;
+  p->deadline = 0;
+  p->edfutil = 0;
+  p->misses = 0;
+  p->wakets = 0;
+  p->timer.pprev = 0;
+  p->rtime = p->wtime = p->stime = 0;
   for(int i=0; i<5; i++)
     p->time[i] = 0;
-  #ifdef MLFQ
-    for(int i=0; i<5; i++) {
-      if(!isFull(i)) {
-        enQueue(i, p);
-        break;
-      }
-    }
-  #endif
 
   release(&ptable.lock);
 
   // Allocate kernel stack.
   if((p->kstack = kalloc()) == 0){
-    p->state = UNUSED;
+    acquire(&ptable.lock);
+    freeproc(p);
+    release(&ptable.lock);
     return 0;
   }
   sp = p->kstack + KSTACKSIZE;
@@ -146,10 +242,9 @@ userinit(void)
   p = allocproc();
   
   initproc = p;
-  if((p->pgdir = setupkvm()) == 0)
+  if((p->pgdir = setupkvm()) == 0 || (p->vm = vmcreate(p->pgdir, PGSIZE)) == 0)
     panic("userinit: out of memory?");
   inituvm(p->pgdir, _binary_initcode_start, (int)_binary_initcode_size);
-  p->sz = PGSIZE;
   memset(p->tf, 0, sizeof(*p->tf));
   p->tf->cs = (SEG_UCODE << 3) | DPL_USER;
   p->tf->ds = (SEG_UDATA << 3) | DPL_USER;
@@ -166,32 +261,43 @@ userinit(void)
   // run this process. the acquire forces the above
   // writes to be visible, and the lock is also needed
   // because the assignment might not be atomic.
-  acquire(&ptable.lock);
+  acquire(&p->lock);
 
   p->state = RUNNABLE;
+  p->statetsc = rdtsc();
+  runqput(p, mycpu());
 
-  release(&ptable.lock);
+  release(&p->lock);
 }
 
 // Grow current process's memory by n bytes.
-// Return 0 on success, -1 on failure.
+// Return the old size, or -1 on failure.
 int
 growproc(int n)
 {
-  uint sz;
+  uint sz, oldsz;
   struct proc *curproc = myproc();
+  struct vmspace *vm = curproc->vm;
 
-  sz = curproc->sz;
+  // Threads share vm: grow it one at a time, so each
+  // sbrk() caller gets its own range.
+  acquire(&vm->lock);
+  sz = oldsz = vm->sz;
   if(n > 0){
-    if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    if((sz = allocuvm(vm->pgdir, sz, sz + n)) == 0){
+      release(&vm->lock);
       return -1;
+    }
   } else if(n < 0){
-    if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    if((sz = deallocuvm(vm->pgdir, sz, sz + n)) == 0){
+      release(&vm->lock);
       return -1;
+    }
   }
-  curproc->sz = sz;
+  vm->sz = sz;
+  release(&vm->lock);
   switchuvm(curproc);
-  return 0;
+  return oldsz;
 }
 
 // Create a new process copying p as the parent.
@@ -210,14 +316,20 @@ fork(void)
   }
 
   // Copy process state from proc.
-  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
-    kfree(np->kstack);
-    np->kstack = 0;
-    np->state = UNUSED;
+  if((np->pgdir = copyuvm(curproc->pgdir, curproc->vm->sz)) == 0 ||
+     (np->vm = vmcreate(np->pgdir, curproc->vm->sz)) == 0){
+    if(np->pgdir)
+      freevm(np->pgdir);
+    np->pgdir = 0;
+    acquire(&ptable.lock);
+    freeproc(np);
+    release(&ptable.lock);
     return -1;
   }
-  np->sz = curproc->sz;
-  np->parent = curproc;
+  np->vruntime = curproc->vruntime;  // start level with the parent
+  np->tickets = curproc->tickets;
+  np->pass = curproc->pass;
+  np->affinity = curproc->affinity;
   *np->tf = *curproc->tf;
 
   // Clear %eax so that fork returns 0 in the child.
@@ -233,11 +345,81 @@ fork(void)
   pid = np->pid;
 
   acquire(&ptable.lock);
+  np->parent = curproc;
+  np->sibling = curproc->child;
+  curproc->child = np;
+  release(&ptable.lock);
+
+  acquire(&np->lock);
 
   np->state = RUNNABLE;
+  np->statetsc = rdtsc();
+  np->cpu = cpuid();
+  runqwake(np);
+
+  release(&np->lock);
+
+  return pid;
+}
+
+// Create a thread that runs fn(arg) on the one page user
+// stack at stack, sharing the caller's address space.  It
+// gets the caller's open files and cwd as a forked child
+// would, and is reaped by join() rather than wait().
+int
+clone(uint fn, uint stack, uint arg)
+{
+  int i, pid;
+  uint sp, ustack[2];
+  struct proc *np;
+  struct proc *curproc = myproc();
+
+  if(stack + PGSIZE < stack || stack + PGSIZE > curproc->vm->sz)
+    return -1;
+  sp = stack + PGSIZE - sizeof(ustack);
+  ustack[0] = 0xffffffff;  // fake return PC
+  ustack[1] = arg;
+  if(copyout(curproc->pgdir, sp, ustack, sizeof(ustack)) < 0)
+    return -1;
+
+  if((np = allocproc()) == 0)
+    return -1;
+  vmget(curproc->vm);
+  np->vm = curproc->vm;
+  np->pgdir = curproc->pgdir;
+  np->ustack = stack;
+  np->vruntime = curproc->vruntime;
+  np->tickets = curproc->tickets;
+  np->pass = curproc->pass;
+  np->affinity = curproc->affinity;
+  *np->tf = *curproc->tf;
+  np->tf->eip = fn;
+  np->tf->esp = sp;
+
+  for(i = 0; i < NOFILE; i++)
+    if(curproc->ofile[i])
+      np->ofile[i] = filedup(curproc->ofile[i]);
+  np->cwd = idup(curproc->cwd);
+
+  safestrcpy(np->name, curproc->name, sizeof(curproc->name));
 
+  pid = np->pid;
+
+  acquire(&ptable.lock);
+  np->parent = curproc;
+  np->sibling = curproc->child;
+  curproc->child = np;
   release(&ptable.lock);
 
+  acquire(&np->lock);
+
+  np->state = RUNNABLE;
+  np->statetsc = rdtsc();
+  np->cpu = cpuid();
+  runqwake(np);
+
+  release(&np->lock);
+
   return pid;
 }
 
@@ -253,6 +435,9 @@ exit(void)
   if(curproc == initproc)
     panic("init exiting");
 
+  // Give back any EDF utilization.
+  edfset(curproc, 0, 0);
+
   // Close all open files.
   for(fd = 0; fd < NOFILE; fd++){
     if(curproc->ofile[fd]){
@@ -272,22 +457,23 @@ exit(void)
   wakeup1(curproc->parent);
 
   // Pass abandoned children to init.
-  for(pq = ptable.proc; pq < &ptable.proc[NPROC]; pq++){
-    if(pq->parent == curproc){
-      pq->parent = initproc;
-      if(pq->state == ZOMBIE)
-        wakeup1(initproc);
-    }
-    // if(pq->pid == 2 && curproc->pid > 2)              DO NOT ENTER PROCESS WITH PID 2 AGAIN AND AGAIN
-    // {
-    //   p = pq;
-    // }
-
+  while((pq = curproc->child) != 0){
+    curproc->child = pq->sibling;
+    pq->parent = initproc;
+    pq->sibling = initproc->child;
+    initproc->child = pq;
+    if(pq->state == ZOMBIE)
+      wakeup1(initproc);
   }
 
+  // Holding curproc->lock keeps wait() from freeing our
+  // kernel stack until the scheduler has switched off it.
+  acquire(&curproc->lock);
   curproc->endTime = ticks;
-  // Jump into the scheduler, never to return.
   curproc->state = ZOMBIE;
+  release(&ptable.lock);
+
+  // Jump into the scheduler, never to return.
   sched();
   panic("zombie exit");
 }
@@ -297,32 +483,29 @@ exit(void)
 int
 wait(void)
 {
-  struct proc *p;
+  struct proc *p, **pp;
   int havekids, pid;
   struct proc *curproc = myproc();
   
   acquire(&ptable.lock);
   for(;;){
-    // Scan through table looking for exited children.
+    // Scan through our children looking for exited ones.
     havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != curproc)
-        continue;
+    for(pp = &curproc->child; (p = *pp) != 0; pp = &p->sibling){
+      if(p->vm == curproc->vm)
+        continue;  // a thread; see join()
       havekids = 1;
+      acquire(&p->lock);
       if(p->state == ZOMBIE){
         // Found one.
         pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
-        freevm(p->pgdir);
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
-        p->state = UNUSED;
+        *pp = p->sibling;
+        freeproc(p);
+        release(&p->lock);
         release(&ptable.lock);
         return pid;
       }
+      release(&p->lock);
     }
 
     // No point waiting if we don't have any children.
@@ -336,38 +519,73 @@ wait(void)
   }
 }
 
+// Wait for a thread made by clone() to exit, store the
+// stack it was given in *stack and return its pid.
+// Return -1 if this process has no threads.
+int
+join(uint *stack)
+{
+  struct proc *p, **pp;
+  int havekids, pid;
+  struct proc *curproc = myproc();
+
+  acquire(&ptable.lock);
+  for(;;){
+    havekids = 0;
+    for(pp = &curproc->child; (p = *pp) != 0; pp = &p->sibling){
+      if(p->vm != curproc->vm)
+        continue;
+      havekids = 1;
+      acquire(&p->lock);
+      if(p->state == ZOMBIE){
+        pid = p->pid;
+        *stack = p->ustack;
+        *pp = p->sibling;
+        freeproc(p);  // just drops p's use of the pgdir
+        release(&p->lock);
+        release(&ptable.lock);
+        return pid;
+      }
+      release(&p->lock);
+    }
+
+    if(!havekids || curproc->killed){
+      release(&ptable.lock);
+      return -1;
+    }
+    sleep(curproc, &ptable.lock);
+  }
+}
+
 int
 waitx(int* wtime, int* rtime)
 {
-  struct proc *p;
+  struct proc *p, **pp;
   int havekids, pid;
   struct proc *curproc = myproc();
   
   acquire(&ptable.lock);
   for(;;){
-    // Scan through table looking for exited children.
+    // Scan through our children looking for exited ones.
     havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != curproc)
-        continue;
+    for(pp = &curproc->child; (p = *pp) != 0; pp = &p->sibling){
+      if(p->vm == curproc->vm)
+        continue;  // a thread; see join()
       havekids = 1;
+      acquire(&p->lock);
       if(p->state == ZOMBIE){
         // Found one.
         pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
-        freevm(p->pgdir);
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
-        p->state = UNUSED;
         *rtime = p->runTime;
         *wtime = p->endTime - p->startTime - p->runTime;
+        *pp = p->sibling;
+        freeproc(p);
         // // cprintf("***********%d %d %d %d %d %d**********\n", p->endTime, p->startTime, p->runTime, p->wait_queue_time, *rtime, *wtime);
+        release(&p->lock);
         release(&ptable.lock);
         return pid;
       }
+      release(&p->lock);
     }
 
     // No point waiting if we don't have any children.
@@ -385,7 +603,7 @@ waitx(int* wtime, int* rtime)
 // Per-CPU process scheduler.
 // Each CPU calls scheduler() after setting itself up.
 // Scheduler never returns.  It loops, doing:
-//  - choose a process to run
+//  - choose a process from this CPU's run queue
 //  - swtch to start running that process
 //  - eventually that process transfers control
 //      via swtch back to the scheduler.
@@ -393,252 +611,61 @@ void
 scheduler(void)
 {
   struct cpu *c = mycpu();
-  struct proc* p = 0;
-  c->proc = 0;
-  #ifdef ROUND_ROBIN
-    for(;;){
-      // Enable interrupts on this processor.
-      sti();
-
-      // Loop over process table looking for process to run.
-      acquire(&ptable.lock);
-      for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-        if(p->state != RUNNABLE)
-          continue;
-
-        // Switch to chosen process.  It is the process's job
-        // to release ptable.lock and then reacquire it
-        // before jumping back to us.
-        // cprintf("%d ** %d\n", c->apicid, p->pid);
-        c->proc = p;
-        switchuvm(p);
-        p->state = RUNNING;
-
-        swtch(&(c->scheduler), p->context);
-        switchkvm();
-
-        // Process is done running for now.
-        // It should have changed its p->state before coming back.
-        c->proc = 0;
-      }
-      release(&ptable.lock);
-
-    }
-  #else
-  #ifdef FCFS
-    for(;;){
-      // Enable interrupts on this processor.
-      sti();
-
-      int minTime = -1;
-      struct proc* minProc = 0;
-
-      // Loop over process table looking for process to run.
-      acquire(&ptable.lock);
-      for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-        if(p->state != RUNNABLE)
-          continue;
-        if(minTime == -1){
-          minTime = p->startTime;
-          minProc = p;
-        }
-        else if(minTime > p->startTime){
-          minTime = p->startTime;
-          minProc = p;
-        }
+  struct proc *p;
+  uint64 t, now;
 
-      }
-      if(minProc!=0){
-        p = minProc;
-        cprintf("%d ** %d\n", c->apicid, p->pid);
-        // Switch to chosen process.  It is the process's job
-        // to release ptable.lock and then reacquire it
-        // before jumping back to us.
-        c->proc = p;
-        switchuvm(p);
-        p->state = RUNNING;
-
-        swtch(&(c->scheduler), p->context);
-        switchkvm();
-
-        // Process is done running for now.
-        // It should have changed its p->state before coming back.
-        c->proc = 0;
-      }
-      release(&ptable.lock);
-    }
-  #else
-  #ifdef PBS
-    for(;;){
-      // Enable interrupts on this processor.
-      sti();
-
-      struct proc* minProc = 0;
-      struct proc* pq = 0;
-      // Loop over process table looking for process to run.
-      acquire(&ptable.lock);
-      for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){                                       // To implement Round Robin in case of processes with equal priority
-        if(p->state != RUNNABLE)
-          continue;
-        minProc = p;
-        for(pq = ptable.proc; pq < &ptable.proc[NPROC]; pq++) {
-          if(pq->state == RUNNABLE && pq->priority < minProc->priority) {
-            minProc = pq;
-          }
-        }
-        if(minProc!=0){
-          p = minProc;
-          // cprintf("%d ** %d\n", c->apicid, p->pid);
-          // Switch to chosen process.  It is the process's job
-          // to release ptable.lock and then reacquire it
-          // before jumping back to us.
-          c->proc = p;
-          switchuvm(p);
-          p->state = RUNNING;
-
-          swtch(&(c->scheduler), p->context);
-          switchkvm();
-
-          // Process is done running for now.
-          // It should have changed its p->state before coming back.
-          c->proc = 0;
-        }
-      }
-      release(&ptable.lock);
+  c->proc = 0;
+  c->tsc0 = rdtsc();
+  for(;;){
+    // Enable interrupts on this processor.
+    sti();
+
+    if((p = runqpick(c)) == 0){
+      // Nothing queued here, so take work from the busiest
+      // cpu, or zero a page for kzalloc(), or halt until
+      // there is some.
+      if(runqsteal(c) == 0 && kzfill() == 0)
+        schedidle(c);
+      continue;
     }
-  #else
-  #ifdef MLFQ
-    int flag = 0;
-    for(;;){
-      // // cprintf("for;;\n");
-      // Enable interrupts on this processor.
-      sti();
-      acquire(&ptable.lock);
-      // // cprintf("%d **** %d\n", qSize[0], qSize[1]);
-      if(!isEmpty(0)){
-        int cnt = 0;
-        while(cnt != qSize[0]){
-          cnt++;
-          p = deQueue(0);
-          flag = 1;
-          if(p->state != RUNNABLE){
-            enQueue(0, p);
-            flag = 0;
-          }
-          else{
-            break;
-          }
-        }
-      }
-      if(!isEmpty(1) && flag==0){
-        int cnt = 0;
-        while(cnt != qSize[1]){
-          cnt++;
-          p = deQueue(1);
-          flag = 1;
-          if(p->state != RUNNABLE){
-            enQueue(1, p);
-            flag = 0;
-          }
-          else
-            break;
-        }
-      }
-      if(!isEmpty(2) && flag==0){
-        int cnt = 0;
-        while(cnt != qSize[2]){
-          cnt++;
-          p = deQueue(2);
-          flag = 1;
-          if(p->state != RUNNABLE){
-            enQueue(2, p);
-            flag = 0;
-          }
-          else
-            break;
-        }
-      }
-      if(!isEmpty(3) && flag==0){
-        int cnt = 0;
-        while(cnt != qSize[3]){
-          cnt++;
-          p = deQueue(3);
-          flag = 1;
-          if(p->state != RUNNABLE){
-            enQueue(3, p);
-            flag = 0;
-          }
-          else
-            break;
-        }
-      } 
-      if(!isEmpty(4) && flag==0){
-        int cnt = 0;
-        while(cnt != qSize[4]){
-          cnt++;
-          p = deQueue(4);
-          flag = 1;
-          if(p->state != RUNNABLE){
-            enQueue(4, p);
-            flag = 0;
-          }
-          else
-            break;
-        }
-      }
-      if(flag == 1 && p->state == RUNNABLE){
-        p->num_run++;
-        flag = 0;  
-        p->wait_queue_time = 0;
-        c->proc = p;
-        switchuvm(p);
-        p->state = RUNNING;
-
-        cprintf("pid = %d, queue = %d, waittime = %d size = %d runtime = %d\n", p->pid, p->queue, p->wait_queue_time, qSize[p->queue], p->runTime);
-
-        swtch(&(c->scheduler), p->context);
-        switchkvm();
-        // if(p->state == RUNNING) {
-        //   cprintf("RUNNING\n");
-        // }
-        // if(p->state == ZOMBIE) {
-        //   cprintf("ZOMBIE\n");
-        // }
-        // if(p->state == RUNNABLE) {
-        //   cprintf("RUNNABLE\n");
-        // }
-        // if(p->state == EMBRYO) {
-        //   cprintf("EMBRYO\n");
-        // }
-        // if(p->state == UNUSED) {
-        //   cprintf("UNUSED\n");
-        // }
-        // if(p->state == SLEEPING) {
-        //   cprintf("SLEEPING\n");
-        // }
-        // Process is done running for now.
-        // It should have changed its p->state before coming back.
-        p = 0;      
-        c->proc = 0;
-      }
 
-      if(flag == 0)
-      {
-        for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-          if(p->state != RUNNABLE || p -> pid == 0)
-            continue;
-          enQueue(0, p);                        // insert all runnable process without a queue and runnable into queue number 0
-        }
-      }
-      release(&ptable.lock);
+    // Switch to chosen process.  It is the process's job
+    // to release p->lock and then reacquire it
+    // before jumping back to us.  p may still be on its
+    // way out of another CPU, in which case acquire waits
+    // for that CPU's scheduler to let go of it.
+    acquire(&p->lock);
+    if(p->state != RUNNABLE)
+      panic("scheduler: not runnable");
+    p->num_run++;
+    now = rdtsc();
+    p->wtime += now - p->statetsc;
+    p->statetsc = now;
+    if(p->wakets){
+      t = now - p->wakets;
+      c->nwake++;
+      c->waketsc += t;
+      if(t > c->maxwake)
+        c->maxwake = t;
+      p->wakets = 0;
     }
-  #endif
-  #endif
-  #endif
-  #endif
+    c->proc = p;
+    switchuvm(p);
+    p->state = RUNNING;
+    trace(TR_SWITCHIN, p, c->rq.nrunnable);
+
+    swtch(&(c->scheduler), p->context);
+    switchkvm();
+    trace(TR_SWITCHOUT, p, p->state == RUNNABLE);
+
+    // Process is done running for now.
+    // It should have changed its p->state before coming back.
+    c->proc = 0;
+    release(&p->lock);
+  }
 }
 
-// Enter scheduler.  Must hold only ptable.lock
+// Enter scheduler.  Must hold only p->lock
 // and have changed proc->state. Saves and restores
 // intena because intena is a property of this
 // kernel thread, not this CPU. It should
@@ -649,16 +676,20 @@ void
 sched(void)
 {
   int intena;
+  uint64 now;
   struct proc *p = myproc();
 
-  if(!holding(&ptable.lock))
-    panic("sched ptable.lock");
+  if(!holding(&p->lock))
+    panic("sched p->lock");
   if(mycpu()->ncli != 1)
     panic("sched locks");
   if(p->state == RUNNING)
     panic("sched running");
   if(readeflags()&FL_IF)
     panic("sched interruptible");
+  now = rdtsc();
+  p->rtime += now - p->statetsc;
+  p->statetsc = now;
   intena = mycpu()->intena;
   swtch(&p->context, mycpu()->scheduler);
   mycpu()->intena = intena;
@@ -668,18 +699,14 @@ sched(void)
 void
 yield(void)
 {
-  acquire(&ptable.lock);  //DOC: yieldlock
-  myproc()->state = RUNNABLE;
-  cprintf("Yield called\n");
-  #ifdef MLFQ
-    cprintf("PREMPTION %d with curTime %d\n", myproc()->pid, myproc()->curTime);
-    myproc()->queue++;
-    myproc()->curTime = 0;
-    enQueue(myproc()->queue, myproc());
-
-  #endif
+  struct proc *p = myproc();
+
+  acquire(&p->lock);  //DOC: yieldlock
+  trace(TR_PREEMPT, p, 0);
+  p->state = RUNNABLE;
+  runqput(p, mycpu());
   sched();
-  release(&ptable.lock);
+  release(&p->lock);
 }
 
 // A fork child's very first scheduling by scheduler()
@@ -688,8 +715,8 @@ void
 forkret(void)
 {
   static int first = 1;
-  // Still holding ptable.lock from scheduler.
-  release(&ptable.lock);
+  // Still holding p->lock from scheduler.
+  release(&myproc()->lock);
 
   if (first) {
     // Some initialization functions must be run in the context
@@ -709,6 +736,7 @@ void
 sleep(void *chan, struct spinlock *lk)
 {
   struct proc *p = myproc();
+  struct sleepq *q;
   
   if(p == 0)
     panic("sleep");
@@ -716,54 +744,99 @@ sleep(void *chan, struct spinlock *lk)
   if(lk == 0)
     panic("sleep without lk");
 
-  // Must acquire ptable.lock in order to
+  // Must acquire p->lock in order to
   // change p->state and then call sched.
-  // Once we hold ptable.lock, we can be
+  // Once we hold chan's queue lock, we can be
   // guaranteed that we won't miss any wakeup
-  // (wakeup runs with ptable.lock locked),
+  // (wakeup locks the queue),
   // so it's okay to release lk.
-  if(lk != &ptable.lock){  //DOC: sleeplock0
-    acquire(&ptable.lock);  //DOC: sleeplock1
-    release(lk);
-  }
+  q = sleepqof(chan);
+  acquire(&q->lock);  //DOC: sleeplock1
+  acquire(&p->lock);
+  release(lk);
+
   // Go to sleep.
   p->chan = chan;
   p->state = SLEEPING;
+  p->sqprev = 0;
+  p->sqnext = q->head;
+  if(q->head)
+    q->head->sqprev = p;
+  q->head = p;
+  release(&q->lock);
 
   sched();
 
-  // Tidy up.
+  // Tidy up.  Whoever woke us took us off the queue.
   p->chan = 0;
 
   // Reacquire original lock.
-  if(lk != &ptable.lock){  //DOC: sleeplock2
-    release(&ptable.lock);
-    acquire(lk);
-  }
+  release(&p->lock);
+  acquire(lk);
 }
 
 //PAGEBREAK!
+// Take p, SLEEPING on q, off q and make it RUNNABLE.
+// Caller must hold q->lock and p->lock.
+static void
+wakeproc(struct sleepq *q, struct proc *p)
+{
+  uint64 now;
+
+  if(p->sqprev)
+    p->sqprev->sqnext = p->sqnext;
+  else
+    q->head = p->sqnext;
+  if(p->sqnext)
+    p->sqnext->sqprev = p->sqprev;
+  p->sqnext = p->sqprev = 0;
+  now = rdtsc();
+  p->stime += now - p->statetsc;
+  p->statetsc = now;
+  p->state = RUNNABLE;
+  runqwake(p);
+}
+
+// Wake up to n processes sleeping on chan, or all of them
+// if n < 0, and return how many woke.  Each one goes back
+// on the run queue it last ran from.  Only chan's hash
+// chain is searched.
+int
+wakeupn(void *chan, int n)
+{
+  struct sleepq *q;
+  struct proc *p, *next;
+  int woke;
+
+  woke = 0;
+  q = sleepqof(chan);
+  acquire(&q->lock);
+  for(p = q->head; p && woke != n; p = next){
+    next = p->sqnext;
+    // p->chan cannot change while p is on q.
+    if(p->chan != chan)
+      continue;
+    acquire(&p->lock);
+    wakeproc(q, p);
+    release(&p->lock);
+    woke++;
+  }
+  release(&q->lock);
+  return woke;
+}
+
 // Wake up all processes sleeping on chan.
-// The ptable lock must be held.
 static void
 wakeup1(void *chan)
 {
-  struct proc *p;
-
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == SLEEPING && p->chan == chan)
-    {  
-      p->state = RUNNABLE;
-    }
+  wakeupn(chan, -1);
 }
 
 // Wake up all processes sleeping on chan.
 void
 wakeup(void *chan)
 {
-  acquire(&ptable.lock);
   wakeup1(chan);
-  release(&ptable.lock);
 }
 
 // Kill the process with the given pid.
@@ -773,20 +846,32 @@ int
 kill(int pid)
 {
   struct proc *p;
+  struct sleepq *q;
+  void *chan;
 
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
-      return 0;
-    }
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  acquire(&p->lock);
+  p->killed = 1;
+  // Wake process from sleep if necessary.  The queue lock
+  // comes before p->lock, so look up p's channel first and
+  // check it again once both are held.
+  while(p->state == SLEEPING){
+    chan = p->chan;
+    release(&p->lock);
+    q = sleepqof(chan);
+    acquire(&q->lock);
+    acquire(&p->lock);
+    if(p->state == SLEEPING && p->chan == chan)
+      wakeproc(q, p);
+    release(&q->lock);
   }
+  release(&p->lock);
   release(&ptable.lock);
-  return -1;
+  return 0;
 }
 
 //PAGEBREAK: 36
@@ -826,217 +911,173 @@ procdump(void)
   }
 }
 
-void
-update_proc_time(void)
-{
-  // cprintf("%%%%%%%%%%%%%%%%%%\n");
-  // for(int i = 0; i < 5; i++)
-  //   {
-  //     if(front[i] <= rear[i])
-  //     {
-  //       for(int j = front[i]; j>=0 && j <= rear[i]; j++)
-  //       {
-  //         // if(q[i][j] != 0)
-  //           // cprintf("%d ^^^ %d ^^^ %d\n", i, j, q[i][j] -> pid);
-  //         // if(element == q[i][j])
-  //         // {
-  //         //   // cprintf("IIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIII\n");
-  //         //   return;
-  //         // }
-  //       }
-  //     }
-
-  //     else
-  //     {
-  //       for(int j = 0; j < 100; j++)
-  //       {
-  //         if(j <= rear[i] || j >= front[i])
-  //         {
-  //           // if(q[i][j] != 0)
-  //             // cprintf("%d ^^^ %d ^^^ %d\n", i, j, q[i][j] -> pid);
-  //           // if(element == q[i][j])
-  //           // {
-  //           // // cprintf("IIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIII\n");
-  //           //   return;
-  //           // }
-  //         }
-  //       }
-  //     }
-  //   }
-  acquire(&ptable.lock);
-  struct proc *p;
-	for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-  	if(p->state == RUNNING){	
-      p->runTime++;
-      #ifdef MLFQ
-      p->time[p->queue]++;
-      p->curTime++;     
-      // // cprintf("*** %d  update_proc_time ***\n", p -> curTime);
-      // if(p->queue!=4 && p->curTime > qticks[p->queue]){
-      //   // cprintf("here **********\n");
-      //   p->queue++;
-      //   p->curTime = 0;
-      //   enQueue(p->queue, p);
-      //   release(&ptable.lock);
-      //   yield();
-      //   acquire(&ptable.lock);
-      // }
-      #endif
-    }
-  	else
-  	{	
-      p->wait_queue_time++;
-      #ifdef MLFQ
-      if(p->wait_queue_time > maxage && p->queue != 0) {
-        p->queue--;
-        p->curTime = 0;
-        p->wait_queue_time = 0;
-        enQueue(p->queue, p);
-        cprintf("AGING %d\n", p->pid);
-      }
-      #endif
-    }  
-  }
-  release(&ptable.lock);
-}
-
 int
 set_priority(int new_priority, int pid)
 {
   struct proc* p;
   int prev_priority = -1;
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      prev_priority = p->priority;
-      p->priority = new_priority;
-      break; 
-    }
+  if((p = findproc(pid)) != 0){
+    acquire(&p->lock);
+    prev_priority = p->priority;
+    p->priority = new_priority;
+    runqrenice(p);
+    release(&p->lock);
   }
   release(&ptable.lock);
   return prev_priority;
 }
 
+// Let process pid run only on the cpus in mask.
+// Returns 0, or -1 if there is no such process or
+// mask names no cpu.
 int
-isFull(int num)
+setaffinity(int pid, uint mask)
 {
-    if( (front[num] == rear[num] + 1) || (front[num] == 0 && rear[num] == 99)) return 1;
-    return 0;
+  struct proc *p;
+
+  mask &= (1 << ncpu) - 1;
+  if(mask == 0)
+    return -1;
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  acquire(&p->lock);
+  p->affinity = mask;
+  runqaffine(p);
+  release(&p->lock);
+  release(&ptable.lock);
+  return 0;
 }
 
+// Return the cpus process pid may run on, or -1.
 int
-isEmpty(int num)
+getaffinity(int pid)
 {
-    if(front[num] == -1) return 1;
-    return 0;
+  struct proc *p;
+  int mask;
+
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  mask = p->affinity & ((1 << ncpu) - 1);
+  release(&ptable.lock);
+  return mask;
 }
 
+// Run p at PBS priority pri or better while it holds a
+// sleeplock that a process of priority pri waits for.  Only
+// PBS sees the lent priority; CFS weights stay as they were.
 void
-enQueue(int num, struct proc* element)
+prioboost(struct proc *p, int pri)
 {
-
-    for(int i = 0; i < 5; i++)
-    {
-      if(front[i] <= rear[i])
-      {
-        for(int j = front[i]; j>=0 && j <= rear[i]; j++)
-        {
-          if(element == q[i][j])
-          {
-            return;
-          }
-        }
-      }
-
-      else
-      {
-        for(int j = 0; j < 100; j++)
-        {
-          if(j <= rear[i] || j >= front[i])
-          {
-            if(element == q[i][j])
-            {
-              return;
-            }
-          }
-        }
-      }
-    }
-
-      if(isFull(num)) cprintf("\n Queue is full!! \n");
-      else
-      {
-          qSize[num]++;
-          element -> curTime = 0;
-          if(front[num] == -1) front[num] = 0;
-          rear[num] = (rear[num] + 1) % 100;
-          q[num][rear[num]] = element;
-      }
+  acquire(&p->lock);
+  if(pri < p->inhpri){
+    p->inhpri = pri;
+    runqrenice(p);
+  }
+  release(&p->lock);
 }
 
-struct proc*
-deQueue(int num)
+// p has released its last sleeplock: drop what it inherited.
+void
+priorestore(struct proc *p)
 {
-    // cprintf("deque called ***********\n");
-    qSize[num]--;
-    struct proc* element;
-    element = q[num][front[num]];
-    if (front[num] == rear[num]){
-        front[num] = -1;
-        rear[num] = -1;
-    } /* Q has only one element, so we reset the queue after dequeing it. ? */
-    else {
-        front[num] = (front[num] + 1) % 100;
-    }
-    // // cprintf("\n Deleted %d\n", element->pid);
-    return element;
+  acquire(&p->lock);
+  if(p->inhpri != NPRIO){
+    p->inhpri = NPRIO;
+    runqrenice(p);
+  }
+  release(&p->lock);
 }
 
-int getpinfo(struct proc_stat* pinfo_p, int pid)
+// Give process pid n tickets for the stride and lottery
+// classes.  Returns the old count, or -1.
+int
+settickets(int pid, int n)
 {
-  struct proc* p = 0;
-  acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid)
-    {
-      pinfo_p->pid = p->pid;
-      pinfo_p->runtime = p->runTime;
-      pinfo_p->num_run = p->num_run;
-      pinfo_p->current_queue = p->queue;
-      
-      for(int i=0; i<5; i++){
-        pinfo_p->ticks[i] = p->time[i]; 
-      }
+  struct proc* p;
+  int old;
 
-      release(&ptable.lock);
-      return 1;
-    }
+  if(n < 1 || n > MAXTICKETS)
+    return -1;
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
   }
-  
+  acquire(&p->lock);
+  old = p->tickets;
+  p->tickets = n;
+  release(&p->lock);
   release(&ptable.lock);
+  return old;
+}
 
+// Put process pid in scheduling class policy, or back under
+// the system policy if policy is SCHED_DEFAULT.  Takes effect
+// the next time the process is queued, or for an EDF process,
+// once it leaves EDF.
+int
+set_sched_class(int pid, int policy)
+{
+  struct proc* p;
+
+  if(policy < SCHED_DEFAULT || policy >= NSCHED || policy == SCHED_EDF)
+    return -1;
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  acquire(&p->lock);
+  if(p->policy == SCHED_EDF)
+    p->edfpolicy = policy;
+  else
+    p->policy = policy;
+  release(&p->lock);
+  release(&ptable.lock);
   return 0;
 }
 
-int higherPriority(int cur_proc_priority, int flag) { 
+int getpinfo(struct proc_stat* pinfo_p, int pid)
+{
   struct proc* p = 0;
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-    if(p->priority < cur_proc_priority && p->pid !=0 ) {
-      // cprintf("%d Higher priority found %d %d\n", p->pid, p->priority, cur_proc_priority);
-      release(&ptable.lock);
-      return 1;
-    }
-  }
-  if(flag) {
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-    if(p->priority == cur_proc_priority && p->pid !=0 ) {
-      // cprintf("%d Equal priority found  and time slice expired %d %d\n", p->pid, p->priority, cur_proc_priority);
-      release(&ptable.lock);
-      return 1;
-    }
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return 0;
   }
+
+  pinfo_p->pid = p->pid;
+  pinfo_p->runtime = p->runTime;
+  pinfo_p->num_run = p->num_run;
+  pinfo_p->current_queue = p->queue;
+  pinfo_p->policy = p->rqclass;
+  pinfo_p->migrations = p->migrations;
+  pinfo_p->cpu = p->cpu;
+  pinfo_p->affinity = p->affinity & ((1 << ncpu) - 1);
+  pinfo_p->steals = p->steals;
+  pinfo_p->tickets = p->tickets;
+  pinfo_p->pass = p->pass;
+  pinfo_p->misses = p->misses;
+  pinfo_p->rtime = div64(cyc2ns(p->rtime), 1000);
+  pinfo_p->wtime = div64(cyc2ns(p->wtime), 1000);
+  pinfo_p->stime = div64(cyc2ns(p->stime), 1000);
+  pinfo_p->priority = pbsprio(p);
+  pinfo_p->inversion = div64(cyc2ns(p->invtsc), 1000);
+  pinfo_p->share = 0;
+  if(ticks > p->startTime)
+    pinfo_p->share = p->runTime * 100 / (ticks - p->startTime);
+
+  for(int i=0; i<5; i++){
+    pinfo_p->ticks[i] = p->time[i]; 
   }
+
   release(&ptable.lock);
-  return 0; 
-}
\ No newline at end of file
+  return 1;
+}
@@ -1,3 +1,45 @@
+// One FIFO per level, for the list-based scheduling classes.
+// Only MLFQ uses levels other than 0.
+struct rqlist {
+  struct proc *head[NQUEUE];
+  struct proc *tail[NQUEUE];
+  uint nonempty;               // Bit i set iff level i has processes
+};
+
+// One FIFO per priority and a bitmap of the nonempty ones,
+// so PBS finds its best queued priority with a bit scan.
+struct rqprio {
+  struct proc *head[NPRIO];
+  struct proc *tail[NPRIO];
+  uint map[NPRIO/32];          // Bit i set iff priority i has processes
+};
+
+// Binary min-heap on p->hkey, for the tree-ordered classes.
+struct rqheap {
+  struct proc *p[NPROC];
+  int n;
+};
+
+// Per-CPU queue of RUNNABLE processes.  Only the owning
+// CPU picks from it; any CPU may append to it.
+struct runq {
+  struct spinlock lock;
+  struct proc *first;          // Every queued process in arrival
+  struct proc *last;           //   order, whatever its class
+  int nrunnable;               // Number of processes on the queue
+  int nclass[NSCHED];          // ... and how many in each class
+  int nthrottled;              // EDF ones out of budget; not ready to run
+  struct rqlist list[NSCHED];  // Per-class storage
+  struct rqheap heap[NSCHED];
+  struct rqprio prio;          // PBS
+  uint minvtime[NSCHED];       // CFS, stride: smallest virtual clock
+  uint lotsum[NPROC+1];        // Lottery: Fenwick tree of tickets
+  uint lottotal;               // Lottery: tickets queued
+  uint seed;                   // Lottery: random number state
+  uint steals;                 // Processes this cpu took from other queues
+  int sincebalance;            // Timer ticks since last rebalance()
+};
+
 // Per-CPU state
 struct cpu {
   uchar apicid;                // Local APIC ID
@@ -8,6 +50,16 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
+  struct runq rq;              // Processes waiting to run on this cpu
+  volatile int idle;           // Halted in schedidle(); send an IPI to wake
+  uint64 tsc0;                 // rdtsc() when scheduler() started
+  uint64 idletsc;              // Cycles spent halted
+  uint nwake;                  // Woken processes run here
+  uint64 waketsc;              // ... total cycles from wakeup to running
+  uint maxwake;                // ... and the longest
+  uint nipi;                   // Reschedule IPIs received
+  uint ntick;                  // Timer interrupts
+  uint64 tickcyc;              // ... and cycles spent handling them
 };
 
 extern struct cpu cpus[NCPU];
@@ -34,30 +86,89 @@ struct context {
 
 enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
+// Entry in the timer wheel (timer.c).  Its sleeper sleeps on
+// the timer's address.
+struct timer {
+  uint expires;                // ticks value to wake at
+  struct timer *next;          // Wheel slot links,
+  struct timer **pprev;        //   pprev is 0 when not on the wheel
+};
+
+// A user address space, shared by a process and the
+// threads it clone()s.  pgdir never changes; exec() gives
+// the caller a new vmspace instead.
+struct vmspace {
+  struct spinlock lock;        // Protects ref, and sz while it changes
+  int ref;                     // Processes using it
+  uint sz;                     // Size of user memory (bytes)
+  pde_t *pgdir;                // Page table
+};
+
 // Per-process state
 struct proc {
-  uint sz;                     // Size of process memory (bytes)
-  pde_t* pgdir;                // Page table
+  struct spinlock lock;        // Protects state, chan and killed
+  struct vmspace *vm;          // Address space, maybe shared with threads
+  pde_t* pgdir;                // Page table, vm->pgdir
   char *kstack;                // Bottom of kernel stack for this process
   enum procstate state;        // Process state
   int pid;                     // Process ID
   struct proc *parent;         // Parent process
+  struct proc *child;          // First child
+  struct proc *sibling;        // Next child of parent
+  struct proc *hnext;          // Next in pid hash chain, or free list
   struct trapframe *tf;        // Trap frame for current syscall
   struct context *context;     // swtch() here to run process
   void *chan;                  // If non-zero, sleeping on chan
+  struct proc *sqnext;         // Sleep queue links, protected
+  struct proc *sqprev;         //   by that queue's lock
+  struct timer timer;          // For sleep_until()
   int killed;                  // If non-zero, have been killed
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
+  uint ustack;                 // User stack given to clone(), for join()
   char name[16];               // Process name (debugging)
   int startTime;
   int runTime;
   int endTime;
-  int wait_queue_time;
-  int priority;
+  uint enqticks;               // ticks when last put on a run queue
+  int priority;                // Set by set_priority(); PBS level, CFS weight
+  int inhpri;                  // PBS priority lent by sleeplock waiters, or NPRIO
+  int nsleeplock;              // Sleeplocks held
+  uint64 invtsc;               // Cycles blocked on worse-priority holders
   int queue;
   int time[5];
   int curTime;
   int num_run;
+  int policy;                  // Requested class, or SCHED_DEFAULT
+  int rqclass;                 // Class p is (or was last) queued in
+  int cpu;                     // Run queue this process is (or was last) on
+  uint affinity;               // Bit i set iff it may run on cpus[i]
+  int migrations;              // Times moved to another cpu's run queue,
+  int steals;                  //   and taken by an idle cpu
+  // While p is queued, cpu, migrations, steals, vruntime and
+  // pass are protected by that run queue's lock, not p->lock.
+  struct proc *qnext;          // Arrival order links on the run queue,
+  struct proc *qprev;          //   protected by that queue's lock
+  int rqlevel;                 // rqlist or rqprio level p is linked on
+  struct proc *rqnext;         // rqlist links, also protected by
+  struct proc *rqprev;         //   the run queue's lock
+  int hidx;                    // Index in rqheap, or -1
+  uint hkey;                   // rqheap ordering key
+  uint vruntime;               // CFS: weighted run time
+  int tickets;                 // Stride, lottery: share of the cpu
+  uint pass;                   // Stride: virtual time
+  int period;                  // EDF: ticks per period
+  int budget;                  // EDF: ticks to run each period
+  int left;                    // EDF: budget left this period
+  uint deadline;               // EDF: end of the current period
+  int edfutil;                 // EDF: budget/period, in thousandths
+  int edfpolicy;               // EDF: policy to go back to when done
+  int misses;                  // EDF: periods that ended short of budget
+  uint64 wakets;               // rdtsc() when woken, 0 once running
+  uint64 rtime;                // TSC cycles spent RUNNING,
+  uint64 wtime;                //   RUNNABLE,
+  uint64 stime;                //   and SLEEPING
+  uint64 statetsc;             // rdtsc() at the last of those changes
 };
 
 // Process memory is laid out contiguously, low addresses first:
@@ -65,5 +176,3 @@ struct proc {
 //   original data and bss
 //   fixed-size stack
 //   expandable heap
-void update_proc_time(void);
-int higherPriority(int, int);               // to check if a higher priority process exists in case of PBS
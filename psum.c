@@ -0,0 +1,100 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "x86.h"
+#include "pinfoheader.h"
+
+// usage: psum [maxthreads]
+// Sums NELEM ints PASSES times with 1, 2, 4, ... threads
+// (up to maxthreads, default the number of cpus) made by
+// thread_create(), each summing its own slice and adding
+// it to the total under a spin lock, and prints the time
+// and speedup over one thread.
+
+#define NELEM   (1 << 20)
+#define PASSES  16
+#define MAXTHR  (NPROC/2)
+
+int *a;
+uint total;
+struct spin lk;
+
+struct slice {
+  int lo, hi;
+} slices[MAXTHR];
+
+void
+worker(void *arg)
+{
+  struct slice *s = arg;
+  uint sum;
+  int i, n;
+
+  sum = 0;
+  for(n = 0; n < PASSES; n++)
+    for(i = s->lo; i < s->hi; i++)
+      sum += a[i];
+  spin_lock(&lk);
+  total += sum;
+  spin_unlock(&lk);
+}
+
+uint
+run(int nthr)
+{
+  uint64 t0;
+  int i;
+
+  total = 0;
+  t0 = rdtsc();
+  for(i = 0; i < nthr; i++){
+    slices[i].lo = NELEM / nthr * i;
+    slices[i].hi = i == nthr - 1 ? NELEM : slices[i].lo + NELEM / nthr;
+    if(thread_create(worker, &slices[i]) < 0){
+      printf(2, "psum: thread_create failed\n");
+      exit();
+    }
+  }
+  for(i = 0; i < nthr; i++)
+    thread_join();
+  return div64(tsc2ns(rdtsc() - t0), 1000);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct cpu_stat cs[NCPU];
+  uint us, us1, x;
+  int i, n, max;
+
+  max = cpustat(cs, NCPU);
+  if(argc > 1)
+    max = atoi(argv[1]);
+  if(max < 1)
+    max = 1;
+  if(max > MAXTHR)
+    max = MAXTHR;
+  if((a = malloc(NELEM * sizeof(int))) == 0){
+    printf(2, "psum: out of memory\n");
+    exit();
+  }
+  for(i = 0; i < NELEM; i++)
+    a[i] = i;
+  spin_init(&lk);
+
+  us1 = 0;
+  for(n = 1; n <= max; n *= 2){
+    us = run(n);
+    if(n == 1)
+      us1 = us;
+    // Sum of 0..NELEM-1, PASSES times, mod 2^32.
+    if(total != (uint)((uint64)NELEM * (NELEM - 1) / 2 * PASSES))
+      printf(2, "psum: wrong sum %d\n", total);
+    x = us ? div64((uint64)us1 * 100, us) : 0;
+    printf(1, "psum: %d threads %d us speedup %d.%d%d\n",
+           n, us, x / 100, x / 10 % 10, x % 10);
+  }
+  free(a);
+  exit();
+}
@@ -0,0 +1,1254 @@
+// Scheduling classes and per-CPU run queues.
+//
+// Each policy is a table of hooks (struct schedclass).  A
+// RUNNABLE process sits on exactly one cpu's run queue, in
+// the storage of the class it was queued under, and on none
+// otherwise.  The system-wide policy can be switched at run
+// time with set_scheduler(); a process may also be given a
+// class of its own with set_sched_class().  Processes that
+// registered with set_edf() are in the real-time EDF class,
+// which runs ahead of every other class.
+//
+// Lock order is p->lock, then rq.lock.  Two run queues are
+// always locked in cpu order.  While p is queued, the lock of
+// its run queue, not p->lock, guards p->cpu, the queue links,
+// the class's clock and the migration counts: runqmove()
+// moves processes between queues holding only the two
+// run queue locks.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sched.h"
+#include "traps.h"
+#include "pinfoheader.h"
+#include "trace.h"
+
+#ifndef SCHED_BOOT
+#define SCHED_BOOT SCHED_ROUND_ROBIN
+#endif
+
+struct schedclass {
+  char *name;
+  // Add p to, or remove p from, c's run queue.
+  // Caller holds c->rq.lock.
+  void (*enqueue)(struct cpu *c, struct proc *p);
+  void (*dequeue)(struct cpu *c, struct proc *p);
+  // The queued process this class would run next on c,
+  // or 0.  Does not remove it.  Caller holds c->rq.lock.
+  struct proc* (*pick_next)(struct cpu *c);
+  // p, RUNNING on this cpu, was charged one timer tick.
+  // Caller holds p->lock.
+  void (*tick)(struct proc *p);
+  // Should p, RUNNING on c, give up the cpu now?
+  // timer is set on clock interrupts.
+  int (*preempt_check)(struct cpu *c, struct proc *p, int timer);
+  // Optional: p, already off src's queue, is about to be
+  // queued on dst.  Caller holds both run queue locks.
+  void (*migrate)(struct cpu *src, struct cpu *dst, struct proc *p);
+  // Optional: one timer tick for the processes waiting on
+  // c's queue.  Caller holds c->rq.lock.
+  void (*age)(struct cpu *c);
+};
+
+// Policy for processes whose p->policy is SCHED_DEFAULT.
+static int schedpolicy = SCHED_BOOT;
+
+static struct spinlock edflock;
+static int edfutil;  // Sum of admitted p->edfutil
+
+static void runqadd(struct cpu *c, struct proc *p);
+static void runqdel(struct cpu *c, struct proc *p);
+static void runqplace(struct proc *p);
+
+// May p run on c?  See sched_setaffinity().
+static int
+cpuok(struct proc *p, struct cpu *c)
+{
+  return (p->affinity >> (c - cpus)) & 1;
+}
+
+void
+schedinit(void)
+{
+  struct cpu *c;
+
+  for(c = cpus; c < &cpus[NCPU]; c++){
+    initlock(&c->rq.lock, "runq");
+    c->rq.seed = c - cpus + 1;
+  }
+  initlock(&edflock, "edf");
+}
+
+//PAGEBREAK: 30
+// List-based classes keep one FIFO per level in c->rq.list[].
+
+static void
+listadd(struct rqlist *l, struct proc *p, int lvl)
+{
+  p->rqlevel = lvl;
+  p->rqnext = 0;
+  p->rqprev = l->tail[lvl];
+  if(l->tail[lvl])
+    l->tail[lvl]->rqnext = p;
+  else
+    l->head[lvl] = p;
+  l->tail[lvl] = p;
+  l->nonempty |= 1 << lvl;
+}
+
+static void
+listdel(struct rqlist *l, struct proc *p)
+{
+  int lvl = p->rqlevel;
+
+  if(p->rqprev)
+    p->rqprev->rqnext = p->rqnext;
+  else
+    l->head[lvl] = p->rqnext;
+  if(p->rqnext)
+    p->rqnext->rqprev = p->rqprev;
+  else
+    l->tail[lvl] = p->rqprev;
+  if(l->head[lvl] == 0)
+    l->nonempty &= ~(1 << lvl);
+  p->rqnext = p->rqprev = 0;
+}
+
+// The single-level classes share enqueue and dequeue.
+static void
+fifo_enqueue(struct cpu *c, struct proc *p)
+{
+  listadd(&c->rq.list[p->rqclass], p, 0);
+}
+
+static void
+fifo_dequeue(struct cpu *c, struct proc *p)
+{
+  listdel(&c->rq.list[p->rqclass], p);
+}
+
+static void
+notick(struct proc *p)
+{
+}
+
+//PAGEBREAK: 40
+// Heap-based classes keep c->rq.heap[] ordered on p->hkey,
+// smallest first.  Keys are compared modulo 2^32 so that
+// they may wrap around.
+#define keybefore(a, b) ((int)((a) - (b)) < 0)
+
+static void
+heapswap(struct rqheap *h, int i, int j)
+{
+  struct proc *t;
+
+  t = h->p[i];
+  h->p[i] = h->p[j];
+  h->p[j] = t;
+  h->p[i]->hidx = i;
+  h->p[j]->hidx = j;
+}
+
+static void
+heapup(struct rqheap *h, int i)
+{
+  while(i > 0 && keybefore(h->p[i]->hkey, h->p[(i-1)/2]->hkey)){
+    heapswap(h, i, (i-1)/2);
+    i = (i-1)/2;
+  }
+}
+
+static void
+heapdown(struct rqheap *h, int i)
+{
+  int l, m;
+
+  for(;;){
+    m = i;
+    l = 2*i + 1;
+    if(l < h->n && keybefore(h->p[l]->hkey, h->p[m]->hkey))
+      m = l;
+    if(l+1 < h->n && keybefore(h->p[l+1]->hkey, h->p[m]->hkey))
+      m = l+1;
+    if(m == i)
+      return;
+    heapswap(h, i, m);
+    i = m;
+  }
+}
+
+static void
+heapadd(struct rqheap *h, struct proc *p)
+{
+  p->hidx = h->n++;
+  h->p[p->hidx] = p;
+  heapup(h, p->hidx);
+}
+
+static void
+heapdel(struct rqheap *h, struct proc *p)
+{
+  int i;
+
+  i = p->hidx;
+  if(i != --h->n){
+    h->p[i] = h->p[h->n];
+    h->p[i]->hidx = i;
+    heapup(h, i);
+    heapdown(h, i);
+  }
+  p->hidx = -1;
+}
+
+static struct proc*
+heaptop(struct rqheap *h)
+{
+  return h->n > 0 ? h->p[0] : 0;
+}
+
+static void
+heap_dequeue(struct cpu *c, struct proc *p)
+{
+  heapdel(&c->rq.heap[p->rqclass], p);
+}
+
+// Round robin: take turns in arrival order, one tick each.
+static struct proc*
+rr_pick(struct cpu *c)
+{
+  return c->rq.list[SCHED_ROUND_ROBIN].head[0];
+}
+
+static int
+rr_preempt(struct cpu *c, struct proc *p, int timer)
+{
+  return timer;
+}
+
+// First come first served: oldest process first, no preemption.
+static struct proc*
+fcfs_pick(struct cpu *c)
+{
+  struct proc *p, *best;
+
+  best = c->rq.list[SCHED_FCFS].head[0];
+  if(best == 0)
+    return 0;
+  for(p = best->rqnext; p; p = p->rqnext)
+    if(p->startTime < best->startTime)
+      best = p;
+  return best;
+}
+
+static int
+fcfs_preempt(struct cpu *c, struct proc *p, int timer)
+{
+  return 0;
+}
+
+// Priority based: lowest pbsprio() first, kept in
+// c->rq.prio.  Equal priorities share a FIFO, so they take
+// turns round robin.
+
+// p's PBS priority: its own, or a better one lent to it by
+// a sleeplock waiter.
+int
+pbsprio(struct proc *p)
+{
+  return p->inhpri < p->priority ? p->inhpri : p->priority;
+}
+
+static int
+pbs_level(struct proc *p)
+{
+  int pri = pbsprio(p);
+
+  if(pri < 0)
+    return 0;
+  if(pri >= NPRIO)
+    return NPRIO-1;
+  return pri;
+}
+
+// Best priority queued on c, or NPRIO if none.
+static int
+pbs_best(struct cpu *c)
+{
+  int i;
+
+  for(i = 0; i < NPRIO/32; i++)
+    if(c->rq.prio.map[i])
+      return i*32 + __builtin_ctz(c->rq.prio.map[i]);
+  return NPRIO;
+}
+
+static void
+pbs_enqueue(struct cpu *c, struct proc *p)
+{
+  struct rqprio *q = &c->rq.prio;
+  int lvl = pbs_level(p);
+
+  p->rqlevel = lvl;
+  p->rqnext = 0;
+  p->rqprev = q->tail[lvl];
+  if(q->tail[lvl])
+    q->tail[lvl]->rqnext = p;
+  else
+    q->head[lvl] = p;
+  q->tail[lvl] = p;
+  q->map[lvl/32] |= 1 << (lvl%32);
+}
+
+static void
+pbs_dequeue(struct cpu *c, struct proc *p)
+{
+  struct rqprio *q = &c->rq.prio;
+  int lvl = p->rqlevel;
+
+  if(p->rqprev)
+    p->rqprev->rqnext = p->rqnext;
+  else
+    q->head[lvl] = p->rqnext;
+  if(p->rqnext)
+    p->rqnext->rqprev = p->rqprev;
+  else
+    q->tail[lvl] = p->rqprev;
+  if(q->head[lvl] == 0)
+    q->map[lvl/32] &= ~(1 << (lvl%32));
+  p->rqnext = p->rqprev = 0;
+}
+
+static struct proc*
+pbs_pick(struct cpu *c)
+{
+  int lvl = pbs_best(c);
+
+  return lvl < NPRIO ? c->rq.prio.head[lvl] : 0;
+}
+
+// Yield to a better priority queued here at any trap, and
+// to an equal one when the time slice ends.
+static int
+pbs_preempt(struct cpu *c, struct proc *p, int timer)
+{
+  int best = pbs_best(c);
+
+  return best < pbs_level(p) || (timer && best == pbs_level(p));
+}
+
+// Multi-level feedback queue: level p->queue, lowest level
+// first.  A process that uses up its slice at a level drops
+// one level; one that waits more than maxage ticks rises one.
+// Each level is a FIFO, so only its head can have waited
+// that long, give or take processes moved in by the balancer.
+// The drop happens when p is next queued, so that the
+// preempt check, run on every trap, changes nothing.
+static void
+mlfq_enqueue(struct cpu *c, struct proc *p)
+{
+  if(p->queue < NQUEUE-1 && p->curTime > qticks[p->queue])
+    p->queue++;
+  p->curTime = 0;
+  listadd(&c->rq.list[SCHED_MLFQ], p, p->queue);
+}
+
+static struct proc*
+mlfq_pick(struct cpu *c)
+{
+  struct rqlist *l = &c->rq.list[SCHED_MLFQ];
+
+  if(l->nonempty == 0)
+    return 0;
+  return l->head[__builtin_ctz(l->nonempty)];
+}
+
+static void
+mlfq_tick(struct proc *p)
+{
+  p->time[p->queue]++;
+  p->curTime++;
+}
+
+static void
+mlfq_age(struct cpu *c)
+{
+  struct rqlist *l = &c->rq.list[SCHED_MLFQ];
+  struct proc *p;
+  int lvl;
+
+  for(lvl = 1; lvl < NQUEUE; lvl++){
+    p = l->head[lvl];
+    if(p == 0 || ticks - p->enqticks <= maxage)
+      continue;
+    listdel(l, p);
+    p->queue--;
+    p->enqticks = ticks;
+    mlfq_enqueue(c, p);
+    trace(TR_AGE, p, 0);
+  }
+}
+
+static int
+mlfq_preempt(struct cpu *c, struct proc *p, int timer)
+{
+  return p->queue < NQUEUE-1 && p->curTime > qticks[p->queue];
+}
+
+//PAGEBREAK: 40
+// Virtual clock classes (CFS, stride) run the queued process
+// whose clock is furthest behind; a running process's clock
+// advances at a rate inverse to its weight.  The clock is
+// copied to p->hkey when p is queued.  rq.minvtime[] follows
+// the smallest clock on each queue and never goes backwards.
+
+// Queue p with its clock at most slack behind the minimum,
+// so a process that slept runs soon but cannot hog the cpu
+// to make up for all the time it was asleep.
+static void
+vt_enqueue(struct cpu *c, struct proc *p, uint *clock, uint slack)
+{
+  uint floor;
+
+  floor = c->rq.minvtime[p->rqclass] - slack;
+  if(keybefore(*clock, floor))
+    *clock = floor;
+  p->hkey = *clock;
+  heapadd(&c->rq.heap[p->rqclass], p);
+}
+
+static struct proc*
+vt_pick(struct cpu *c, int cls)
+{
+  struct proc *p;
+
+  p = heaptop(&c->rq.heap[cls]);
+  if(p && keybefore(c->rq.minvtime[cls], p->hkey))
+    c->rq.minvtime[cls] = p->hkey;
+  return p;
+}
+
+// Running p's clock has advanced to now.
+static void
+vt_advance(struct proc *p, uint now)
+{
+  struct cpu *c;
+  struct proc *q;
+  uint min;
+
+  c = &cpus[p->cpu];
+  acquire(&c->rq.lock);
+  min = now;
+  q = heaptop(&c->rq.heap[p->rqclass]);
+  if(q && keybefore(q->hkey, min))
+    min = q->hkey;
+  if(keybefore(c->rq.minvtime[p->rqclass], min))
+    c->rq.minvtime[p->rqclass] = min;
+  release(&c->rq.lock);
+}
+
+// Yield once some queued process is behind running p.
+static int
+vt_preempt(struct cpu *c, struct proc *p, uint now)
+{
+  struct proc *q;
+  int r;
+
+  acquire(&c->rq.lock);
+  q = heaptop(&c->rq.heap[p->rqclass]);
+  r = q && keybefore(q->hkey, now);
+  release(&c->rq.lock);
+  return r;
+}
+
+// Keep p's place relative to the queue it joins.
+static void
+vt_migrate(struct cpu *src, struct cpu *dst, struct proc *p, uint *clock)
+{
+  *clock += dst->rq.minvtime[p->rqclass] - src->rq.minvtime[p->rqclass];
+}
+
+// Completely fair: the clock is p->vruntime, which gains
+// NICE0/weight ticks (in 1/NICE0 tick units) for each tick
+// p runs, with the weight taken from p->priority.
+#define NICE0    1024
+#define CFSSLACK (3*NICE0)
+
+// Weights for nice -20..19: each step is about 1.25x.
+static uint cfsweights[40] = {
+  88761, 71755, 56483, 46273, 36291,
+  29154, 23254, 18705, 14949, 11916,
+   9548,  7620,  6100,  4904,  3906,
+   3121,  2501,  1991,  1586,  1277,
+   1024,   820,   655,   526,   423,
+    335,   272,   215,   172,   137,
+    110,    87,    70,    56,    45,
+     36,    29,    23,    18,    15,
+};
+
+// Map p->priority (0 best, 100 worst) onto the weights,
+// with the default of 60 at NICE0.
+static uint
+cfs_weight(struct proc *p)
+{
+  int pr, nice;
+
+  pr = p->priority;
+  if(pr < 0)
+    pr = 0;
+  if(pr > 100)
+    pr = 100;
+  if(pr < 60)
+    nice = (pr - 60) / 3;
+  else
+    nice = (pr - 60) * 19 / 40;
+  return cfsweights[nice + 20];
+}
+
+static void
+cfs_enqueue(struct cpu *c, struct proc *p)
+{
+  vt_enqueue(c, p, &p->vruntime, CFSSLACK);
+}
+
+static struct proc*
+cfs_pick(struct cpu *c)
+{
+  return vt_pick(c, SCHED_CFS);
+}
+
+static void
+cfs_tick(struct proc *p)
+{
+  p->vruntime += NICE0*NICE0 / cfs_weight(p);
+  vt_advance(p, p->vruntime);
+}
+
+static int
+cfs_preempt(struct cpu *c, struct proc *p, int timer)
+{
+  return timer && vt_preempt(c, p, p->vruntime);
+}
+
+static void
+cfs_migrate(struct cpu *src, struct cpu *dst, struct proc *p)
+{
+  vt_migrate(src, dst, p, &p->vruntime);
+}
+
+// Stride: the clock is p->pass, which gains STRIDE1/tickets
+// for each tick p runs.  Over time each process gets cpu in
+// exact proportion to its tickets.  A process that slept
+// rejoins at the minimum pass and forfeits what it missed.
+#define STRIDE1 (1 << 20)
+
+static void
+stride_enqueue(struct cpu *c, struct proc *p)
+{
+  vt_enqueue(c, p, &p->pass, 0);
+}
+
+static struct proc*
+stride_pick(struct cpu *c)
+{
+  return vt_pick(c, SCHED_STRIDE);
+}
+
+static void
+stride_tick(struct proc *p)
+{
+  p->pass += STRIDE1 / p->tickets;
+  vt_advance(p, p->pass);
+}
+
+static int
+stride_preempt(struct cpu *c, struct proc *p, int timer)
+{
+  return timer && vt_preempt(c, p, p->pass);
+}
+
+static void
+stride_migrate(struct cpu *src, struct cpu *dst, struct proc *p)
+{
+  vt_migrate(src, dst, p, &p->pass);
+}
+
+//PAGEBREAK: 40
+// Lottery: each tick, draw one of the queued tickets at
+// random and run its holder; the expected share matches
+// stride's.  Queued processes sit unordered in the slots of
+// rq.heap[SCHED_LOTTERY], and rq.lotsum[] is a Fenwick tree
+// over the slots' tickets, so a draw costs O(log n).  p->hkey
+// holds the tickets p was queued with.
+
+static void
+lottery_add(struct runq *rq, int slot, int n)
+{
+  for(slot++; slot <= NPROC; slot += slot & -slot)
+    rq->lotsum[slot] += n;
+}
+
+static void
+lottery_enqueue(struct cpu *c, struct proc *p)
+{
+  struct rqheap *h = &c->rq.heap[SCHED_LOTTERY];
+
+  p->hkey = p->tickets;
+  p->hidx = h->n++;
+  h->p[p->hidx] = p;
+  lottery_add(&c->rq, p->hidx, p->hkey);
+  c->rq.lottotal += p->hkey;
+}
+
+static void
+lottery_dequeue(struct cpu *c, struct proc *p)
+{
+  struct rqheap *h = &c->rq.heap[SCHED_LOTTERY];
+  struct proc *q;
+  int i;
+
+  i = p->hidx;
+  lottery_add(&c->rq, i, -p->hkey);
+  c->rq.lottotal -= p->hkey;
+  if(i != --h->n){
+    q = h->p[h->n];
+    lottery_add(&c->rq, h->n, -q->hkey);
+    h->p[i] = q;
+    q->hidx = i;
+    lottery_add(&c->rq, i, q->hkey);
+  }
+  p->hidx = -1;
+}
+
+static struct proc*
+lottery_pick(struct cpu *c)
+{
+  struct runq *rq = &c->rq;
+  uint r;
+  int pos, step;
+
+  if(rq->lottotal == 0)
+    return 0;
+  rq->seed = rq->seed * 1103515245 + 12345;
+  r = (rq->seed >> 8) % rq->lottotal;
+  // Find the slot whose tickets cover r.
+  pos = 0;
+  for(step = 1 << (31 - __builtin_clz(NPROC)); step > 0; step >>= 1){
+    if(pos + step <= NPROC && rq->lotsum[pos + step] <= r){
+      pos += step;
+      r -= rq->lotsum[pos];
+    }
+  }
+  return rq->heap[SCHED_LOTTERY].p[pos];
+}
+
+//PAGEBREAK: 40
+// Earliest deadline first: a process that registered a
+// (period, budget) pair may run budget ticks in each period,
+// and the one whose period ends first runs first.  A process
+// that used up its budget waits on rq.list[SCHED_EDF], out of
+// the heap, until its next period; rq.nthrottled counts those,
+// so that idle and balancing code do not take them for work.
+// A period that ends while the process still wanted its
+// budget counts as a miss.
+
+// Start p's next period at the later of its deadline and now.
+static void
+edf_renew(struct proc *p)
+{
+  p->deadline += p->period;
+  if(keybefore(p->deadline, ticks))
+    p->deadline = ticks + p->period;
+  p->left = p->budget;
+}
+
+static void
+edf_enqueue(struct cpu *c, struct proc *p)
+{
+  // A process waking after its deadline starts a fresh period.
+  if(!keybefore(ticks, p->deadline))
+    edf_renew(p);
+  if(p->left == 0){
+    listadd(&c->rq.list[SCHED_EDF], p, 0);
+    c->rq.nthrottled++;
+    return;
+  }
+  p->hkey = p->deadline;
+  heapadd(&c->rq.heap[SCHED_EDF], p);
+}
+
+static void
+edf_dequeue(struct cpu *c, struct proc *p)
+{
+  if(p->hidx >= 0)
+    heapdel(&c->rq.heap[SCHED_EDF], p);
+  else {
+    listdel(&c->rq.list[SCHED_EDF], p);
+    c->rq.nthrottled--;
+  }
+}
+
+static struct proc*
+edf_pick(struct cpu *c)
+{
+  return heaptop(&c->rq.heap[SCHED_EDF]);
+}
+
+static void
+edf_tick(struct proc *p)
+{
+  if(p->left > 0)
+    p->left--;
+  if(keybefore(ticks, p->deadline))
+    return;
+  if(p->left > 0)
+    p->misses++;
+  edf_renew(p);
+}
+
+// Start the next period of queued processes whose deadline
+// has passed: first those throttled on the list, then any
+// left in the heap, which are misses.
+static void
+edf_age(struct cpu *c)
+{
+  struct rqheap *h = &c->rq.heap[SCHED_EDF];
+  struct proc *p, *next;
+
+  for(p = c->rq.list[SCHED_EDF].head[0]; p; p = next){
+    next = p->rqnext;
+    if(keybefore(ticks, p->deadline))
+      continue;
+    edf_dequeue(c, p);
+    edf_enqueue(c, p);
+  }
+  while((p = heaptop(h)) != 0 && !keybefore(ticks, p->deadline)){
+    p->misses++;
+    heapdel(h, p);
+    edf_enqueue(c, p);
+  }
+}
+
+static int
+edf_preempt(struct cpu *c, struct proc *p, int timer)
+{
+  struct proc *q;
+
+  if(p->left == 0)
+    return 1;
+  if(!timer)
+    return 0;
+  q = heaptop(&c->rq.heap[SCHED_EDF]);
+  return q && keybefore(q->hkey, p->deadline);
+}
+
+static struct schedclass schedclass[NSCHED] = {
+[SCHED_ROUND_ROBIN] { "rr", fifo_enqueue, fifo_dequeue, rr_pick,
+                      notick, rr_preempt },
+[SCHED_FCFS]        { "fcfs", fifo_enqueue, fifo_dequeue, fcfs_pick,
+                      notick, fcfs_preempt },
+[SCHED_PBS]         { "pbs", pbs_enqueue, pbs_dequeue, pbs_pick,
+                      notick, pbs_preempt },
+[SCHED_MLFQ]        { "mlfq", mlfq_enqueue, fifo_dequeue, mlfq_pick,
+                      mlfq_tick, mlfq_preempt, 0, mlfq_age },
+[SCHED_CFS]         { "cfs", cfs_enqueue, heap_dequeue, cfs_pick,
+                      cfs_tick, cfs_preempt, cfs_migrate },
+[SCHED_STRIDE]      { "stride", stride_enqueue, heap_dequeue, stride_pick,
+                      stride_tick, stride_preempt, stride_migrate },
+[SCHED_LOTTERY]     { "lottery", lottery_enqueue, lottery_dequeue,
+                      lottery_pick, notick, rr_preempt },
+[SCHED_EDF]         { "edf", edf_enqueue, edf_dequeue, edf_pick,
+                      edf_tick, edf_preempt, 0, edf_age },
+};
+
+//PAGEBREAK: 40
+// Class-independent run queue operations.
+
+// Queued processes that could run now.  Read without the
+// lock by the idle and balancing code.
+static int
+runqready(struct cpu *c)
+{
+  return c->rq.nrunnable - c->rq.nthrottled;
+}
+
+// Queue p on c under the class it should run in.
+// Caller must hold c->rq.lock.
+static void
+runqadd(struct cpu *c, struct proc *p)
+{
+  struct runq *rq = &c->rq;
+
+  if(p->cpu != c - cpus)
+    p->migrations++;
+  p->cpu = c - cpus;
+  p->rqclass = p->policy == SCHED_DEFAULT ? schedpolicy : p->policy;
+  p->qnext = 0;
+  p->qprev = rq->last;
+  if(rq->last)
+    rq->last->qnext = p;
+  else
+    rq->first = p;
+  rq->last = p;
+  rq->nrunnable++;
+  rq->nclass[p->rqclass]++;
+  schedclass[p->rqclass].enqueue(c, p);
+  trace(TR_ENQUEUE, p, p->cpu);
+}
+
+// Take p off c's run queue.  Caller must hold c->rq.lock.
+static void
+runqdel(struct cpu *c, struct proc *p)
+{
+  struct runq *rq = &c->rq;
+
+  schedclass[p->rqclass].dequeue(c, p);
+  if(p->qprev)
+    p->qprev->qnext = p->qnext;
+  else
+    rq->first = p->qnext;
+  if(p->qnext)
+    p->qnext->qprev = p->qprev;
+  else
+    rq->last = p->qprev;
+  p->qnext = p->qprev = 0;
+  rq->nrunnable--;
+  rq->nclass[p->rqclass]--;
+}
+
+// Append p to c's run queue, or to another if p may not
+// run on c.  Caller must hold p->lock and have made p RUNNABLE.
+void
+runqput(struct proc *p, struct cpu *c)
+{
+  if(!cpuok(p, c)){
+    runqplace(p);
+    return;
+  }
+  p->enqticks = ticks;
+  acquire(&c->rq.lock);
+  runqadd(c, p);
+  release(&c->rq.lock);
+}
+
+// p has just been made RUNNABLE by fork or wakeup.
+// Caller must hold p->lock.
+void
+runqwake(struct proc *p)
+{
+  p->wakets = rdtsc();
+  runqplace(p);
+}
+
+// Queue p on the cpu it last ran on, or on an idle cpu if
+// that one is busy, and kick the chosen cpu out of hlt.
+// Only cpus in p->affinity are considered.
+// Caller must hold p->lock.
+static void
+runqplace(struct proc *p)
+{
+  struct cpu *c, *i;
+  struct proc *q;
+
+  c = &cpus[p->cpu];
+  if(!c->idle || !cpuok(p, c)){
+    for(i = cpus; i < cpus+ncpu; i++)
+      if(i->idle && cpuok(p, i))
+        break;
+    if(i < cpus+ncpu)
+      c = i;
+    else if(!cpuok(p, c)){
+      // Every allowed cpu is busy: take the least loaded.
+      c = 0;
+      for(i = cpus; i < cpus+ncpu; i++)
+        if(cpuok(p, i) && (c == 0 || runqready(i) < runqready(c)))
+          c = i;
+    }
+  }
+  runqput(p, c);
+  // Pairs with the barrier in schedidle(): either c sees p
+  // on its queue or we see c->idle.
+  __sync_synchronize();
+  if(c == mycpu())
+    return;
+  // A busy cpu only looks at its queue on a trap, so tell it
+  // now if p should preempt what it is running.  c->proc is
+  // read without its lock: a stale answer costs one IPI or
+  // leaves p to the next tick.
+  if(c->idle || (p->rqclass == SCHED_PBS && (q = c->proc) != 0 &&
+                 q->rqclass == SCHED_PBS && pbs_level(p) < pbs_level(q)))
+    lapicipi(c->apicid, T_IRQ0 + IRQ_RESCHED);
+}
+
+// p->affinity has changed.  If p is queued on a cpu it may no
+// longer use, move it; if it is running on one, interrupt
+// that cpu so that schedpreempt() sends it elsewhere.
+// Caller must hold p->lock.
+void
+runqaffine(struct proc *p)
+{
+  struct cpu *c;
+
+  if(p->state == RUNNABLE){
+    c = runqlock(p);
+    if(cpuok(p, c)){
+      release(&c->rq.lock);
+      return;
+    }
+    if(p->qprev || c->rq.first == p){
+      runqdel(c, p);
+      release(&c->rq.lock);
+      runqplace(p);
+      return;
+    }
+    // Taken off the queue by runqpick(); about to run on c.
+    release(&c->rq.lock);
+  } else if(p->state != RUNNING)
+    return;
+  c = &cpus[p->cpu];
+  if(!cpuok(p, c) && c != mycpu())
+    lapicipi(c->apicid, T_IRQ0 + IRQ_RESCHED);
+}
+
+// Nothing to run on c: halt until an interrupt.  Other cpus
+// see c->idle and send a reschedule IPI when they queue work
+// for c.  The queue is checked for the last time with
+// interrupts off, so such an IPI cannot slip in before hlt.
+// Only cpu 0 keeps its timer going while halted, for ticks,
+// and any cpu holding throttled EDF processes, so that
+// edf_age() can give them their next period.
+void
+schedidle(struct cpu *c)
+{
+  uint64 t;
+  int stop;
+
+  c->idle = 1;
+  __sync_synchronize();
+  cli();
+  if(runqready(c) == 0){
+    t = rdtsc();
+    stop = c != &cpus[0] && c->rq.nthrottled == 0;
+    if(stop)
+      lapictimer(0);
+    stihlt();
+    if(stop)
+      lapictimer(1);
+    c->idletsc += rdtsc() - t;
+  }
+  c->idle = 0;
+}
+
+// Lock and return the cpu whose run queue holds p.
+// Caller must hold p->lock and p must be RUNNABLE;
+// the loop catches p being stolen before we got the lock.
+struct cpu*
+runqlock(struct proc *p)
+{
+  struct cpu *c;
+
+  for(;;){
+    c = &cpus[p->cpu];
+    acquire(&c->rq.lock);
+    if(c == &cpus[p->cpu])
+      return c;
+    release(&c->rq.lock);
+  }
+}
+
+// p's priority has changed.  If p is queued under PBS, move
+// it to its new level.  p may be RUNNABLE but already taken
+// off its queue by runqpick(), so check that it is on one.
+// Caller must hold p->lock.
+void
+runqrenice(struct proc *p)
+{
+  struct cpu *c;
+
+  if(p->state != RUNNABLE || p->rqclass != SCHED_PBS)
+    return;
+  c = runqlock(p);
+  if(p->qprev || c->rq.first == p){
+    pbs_dequeue(c, p);
+    pbs_enqueue(c, p);
+  }
+  release(&c->rq.lock);
+}
+
+// Remove and return the process c should run next, or 0
+// if its queue is empty.  EDF goes first, then the system
+// policy's class, then any process given a class of its own.
+struct proc*
+runqpick(struct cpu *c)
+{
+  struct proc *p;
+  int i, pol;
+
+  acquire(&c->rq.lock);
+  pol = schedpolicy;
+  p = 0;
+  if(c->rq.nclass[SCHED_EDF])
+    p = schedclass[SCHED_EDF].pick_next(c);
+  if(p == 0 && c->rq.nclass[pol])
+    p = schedclass[pol].pick_next(c);
+  for(i = 0; p == 0 && i < NSCHED; i++)
+    if(c->rq.nclass[i])
+      p = schedclass[i].pick_next(c);
+  if(p)
+    runqdel(c, p);
+  release(&c->rq.lock);
+  return p;
+}
+
+// One timer tick on this cpu.  Charge it to the process
+// running here, then let the classes age the processes
+// waiting on this cpu's queue.  Every cpu calls this from
+// its own timer interrupt.
+void
+schedtick(void)
+{
+  struct cpu *c;
+  struct proc *p;
+  int i;
+
+  c = mycpu();
+  if((p = c->proc) != 0){
+    acquire(&p->lock);
+    if(p->state == RUNNING){
+      p->runTime++;
+      schedclass[p->rqclass].tick(p);
+    }
+    release(&p->lock);
+  }
+
+  acquire(&c->rq.lock);
+  for(i = 0; i < NSCHED; i++)
+    if(schedclass[i].age && c->rq.nclass[i])
+      schedclass[i].age(c);
+  release(&c->rq.lock);
+}
+
+// Should p, running on this cpu, yield?  A process running
+// outside the system policy's class yields at the next tick
+// to work queued under that class, and any process but an
+// EDF one yields to an EDF process with budget left.
+int
+schedpreempt(struct proc *p, int timer)
+{
+  struct cpu *c;
+  int pol, r;
+
+  pushcli();
+  c = mycpu();
+  pol = schedpolicy;
+  if(!cpuok(p, c))
+    r = 1;
+  else if(timer && p->rqclass != SCHED_EDF && c->rq.heap[SCHED_EDF].n > 0)
+    r = 1;
+  else if(timer && p->rqclass != pol && p->rqclass != SCHED_EDF &&
+          c->rq.nclass[pol] > 0)
+    r = 1;
+  else
+    r = schedclass[p->rqclass].preempt_check(c, p, timer);
+  popcli();
+  return r;
+}
+
+// Set the system-wide policy.  Processes already queued
+// stay in their old class until they next run.
+// Returns the previous policy, or -1 if policy is unknown.
+int
+setscheduler(int policy)
+{
+  int old;
+
+  if(policy < 0 || policy >= NSCHED || policy == SCHED_EDF)
+    return -1;
+  old = schedpolicy;
+  schedpolicy = policy;
+  return old;
+}
+
+int
+getscheduler(void)
+{
+  return schedpolicy;
+}
+
+// Put p in the EDF class with budget ticks in every period,
+// or take it out, back to the class it had before, if both
+// are 0.  Admission control: the utilizations, in thousandths
+// of a cpu, may sum to at most EDFLIMIT.  That is less than
+// one cpu, so the admitted set can meet its deadlines even if
+// all of it ends up queued on a single cpu.  Returns 0, or -1
+// if p was not admitted.
+// Only p itself may call this.
+int
+edfset(struct proc *p, int period, int budget)
+{
+  int u;
+
+  if(period == 0 && budget == 0)
+    u = 0;
+  else if(budget < 1 || period < budget)
+    return -1;
+  else
+    u = (budget * 1000 + period - 1) / period;
+
+  acquire(&edflock);
+  if(edfutil - p->edfutil + u > EDFLIMIT){
+    release(&edflock);
+    return -1;
+  }
+  edfutil += u - p->edfutil;
+  release(&edflock);
+
+  acquire(&p->lock);
+  p->edfutil = u;
+  p->period = period;
+  p->budget = budget;
+  p->left = budget;
+  p->deadline = ticks + period;
+  if(u && p->policy != SCHED_EDF){
+    p->edfpolicy = p->policy;
+    p->policy = SCHED_EDF;
+  } else if(u == 0 && p->policy == SCHED_EDF)
+    p->policy = p->edfpolicy;
+  release(&p->lock);
+  return 0;
+}
+
+//PAGEBREAK: 40
+// Load balancing.
+
+// Return the cpu other than c with the most queued
+// processes, or 0 if every other queue is empty.
+// The counts are read without locks; callers recheck.
+static struct cpu*
+busiest(struct cpu *c)
+{
+  struct cpu *b, *max;
+
+  max = 0;
+  for(b = cpus; b < cpus+ncpu; b++){
+    if(b == c || runqready(b) == 0)
+      continue;
+    if(max == 0 || runqready(b) > runqready(max))
+      max = b;
+  }
+  return max;
+}
+
+// Move processes from src's queue to dst's queue.  An idle
+// dst steals half of src's queue; otherwise dst takes enough
+// to even the two out.  Processes come off the back of the
+// queue: the most recently queued have the coldest caches on src.
+// Processes not allowed on dst, and throttled EDF ones,
+// stay where they are.
+static int
+runqmove(struct cpu *src, struct cpu *dst, int steal)
+{
+  struct runq *first, *second;
+  struct proc *p, *prev;
+  int n, moved;
+
+  first = src < dst ? &src->rq : &dst->rq;
+  second = src < dst ? &dst->rq : &src->rq;
+  acquire(&first->lock);
+  acquire(&second->lock);
+  if(steal)
+    n = (runqready(src) + 1) / 2;
+  else
+    n = (runqready(src) - runqready(dst)) / 2;
+  moved = 0;
+  for(p = src->rq.last; p && moved < n; p = prev){
+    prev = p->qprev;
+    if(!cpuok(p, dst) || (p->rqclass == SCHED_EDF && p->hidx < 0))
+      continue;
+    runqdel(src, p);
+    if(schedclass[p->rqclass].migrate)
+      schedclass[p->rqclass].migrate(src, dst, p);
+    runqadd(dst, p);
+    if(steal){
+      p->steals++;
+      dst->rq.steals++;
+    }
+    moved++;
+  }
+  release(&second->lock);
+  release(&first->lock);
+  return moved;
+}
+
+// c has nothing to run: take half of the busiest queue.
+// Returns the number of processes taken.
+int
+runqsteal(struct cpu *c)
+{
+  struct cpu *b;
+
+  if((b = busiest(c)) == 0)
+    return 0;
+  return runqmove(b, c, 1);
+}
+
+// Called from every busy cpu's timer interrupt.  If work is
+// waiting here, wake an idle cpu to steal it.  Every
+// BALANCEINT ticks, even this cpu's queue out against the
+// busiest one if it has at least two more runnable processes.
+void
+rebalance(void)
+{
+  struct cpu *c, *b;
+
+  c = mycpu();
+  if(runqready(c) > 0){
+    for(b = cpus; b < cpus+ncpu; b++){
+      if(b->idle){
+        lapicipi(b->apicid, T_IRQ0 + IRQ_RESCHED);
+        break;
+      }
+    }
+  }
+  if(++c->rq.sincebalance < BALANCEINT)
+    return;
+  c->rq.sincebalance = 0;
+  b = busiest(c);
+  if(b && runqready(b) - runqready(c) >= 2)
+    runqmove(b, c, 0);
+}
+
+// Copy statistics for up to n cpus into st.
+// Returns the number of cpus copied.
+int
+getcpustats(struct cpu_stat *st, int n)
+{
+  struct cpu *c;
+  uint64 now, total, idle;
+
+  if(n > ncpu)
+    n = ncpu;
+  now = rdtsc();
+  for(c = cpus; c < cpus+n; c++, st++){
+    st->cpu = c - cpus;
+    st->idle = 0;
+    total = now - c->tsc0;
+    idle = c->idletsc;
+    if(c->tsc0 && total >= 1000)
+      st->idle = div64(idle, div64(total, 1000));
+    st->wakeups = c->nwake;
+    st->avgwake = c->nwake ? div64(c->waketsc, c->nwake) : 0;
+    st->maxwake = c->maxwake;
+    st->ipis = c->nipi;
+    st->steals = c->rq.steals;
+    st->ticks = c->ntick;
+    st->tickcyc = c->tickcyc;
+  }
+  return n;
+}
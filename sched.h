@@ -0,0 +1,14 @@
+// Scheduling policies, for set_scheduler() and set_sched_class().
+#define SCHED_DEFAULT     -1  // per-process only: follow the system policy
+#define SCHED_ROUND_ROBIN  0
+#define SCHED_FCFS         1
+#define SCHED_PBS          2  // priority based
+#define SCHED_MLFQ         3  // multi-level feedback queue
+#define SCHED_CFS          4  // completely fair: weighted virtual run time
+#define SCHED_STRIDE       5  // proportional share by tickets
+#define SCHED_LOTTERY      6  // proportional share by random draw
+#define SCHED_EDF          7  // earliest deadline first; see set_edf()
+
+// settickets() limits.
+#define DEFTICKETS       100
+#define MAXTICKETS     10000
@@ -0,0 +1,301 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "x86.h"
+#include "sched.h"
+#include "pinfoheader.h"
+
+// usage: schedbench [policy|all] [cpu|io|mix|all]
+// Runs NJOB children under each policy and workload:
+//   cpu  every job spins through the same fixed work
+//   io   every job blocks on a pipe ROUNDS times; the parent
+//        writes rdtsc() into it once a tick and the job
+//        records how long it took to get back on a cpu,
+//        sending them back on one pipe shared by all jobs
+//   mix  half of each
+// and prints one CSV line per run (see CSVHDR), for
+// "make bench" to collect from the serial console:
+//   throughput  jobs finished per 100 s
+//   turnaround  mean us from start to the job being reaped
+//   p50, p99    wakeup latency of io jobs, us
+//   jain        Jain's fairness index x1000 over the cpu time
+//               (getpinfo) each cpu job had after SNAPTICKS
+
+#define NELEM(x) (sizeof(x)/sizeof((x)[0]))
+
+#define NJOB      8
+#define WORK      10000000  // cpu job loop iterations
+#define ROUNDS    20        // io job wakeups
+#define SNAPTICKS 5         // when to sample cpu shares
+
+#define CSVHDR "cpus,policy,workload,jobs,elapsed_us,throughput,turnaround_us,p50_us,p99_us,jain"
+
+enum { CPU, IO, MIX };
+
+char *policies[] = {
+[SCHED_ROUND_ROBIN] "rr",
+[SCHED_FCFS]        "fcfs",
+[SCHED_PBS]         "pbs",
+[SCHED_MLFQ]        "mlfq",
+[SCHED_CFS]         "cfs",
+[SCHED_STRIDE]      "stride",
+[SCHED_LOTTERY]     "lottery",
+};
+
+char *workloads[] = {
+[CPU] "cpu",
+[IO]  "io",
+[MIX] "mix",
+};
+
+int ncpu;
+
+struct job {
+  int pid;
+  int io;
+  int fd[2];      // Parent writes wakeup stamps into fd[1]
+  uint share;     // us of cpu at the snapshot
+  uint turn;      // us from start to reaped
+};
+
+int res[2];       // Io jobs write their latencies into res[1]
+
+uint
+usnow(void)
+{
+  return div64(tsc2ns(rdtsc()), 1000);
+}
+
+// In a new job, close every descriptor but keep.  Jobs
+// inherit the stamp pipes of the jobs forked before them,
+// and the parent only has NOFILE descriptors to share.
+void
+closeall(int keep)
+{
+  int fd;
+
+  for(fd = 3; fd < NOFILE; fd++)
+    if(fd != keep && fd != res[1])
+      close(fd);
+}
+
+void
+cpujob(void)
+{
+  volatile int x = 0;
+  int i;
+
+  for(i = 0; i < WORK; i++)
+    x += i;
+  exit();
+}
+
+void
+iojob(struct job *j)
+{
+  uint64 stamp;
+  uint lat[ROUNDS];
+  int i, n;
+
+  for(i = 0; i < ROUNDS; i++){
+    if(read(j->fd[0], &stamp, sizeof(stamp)) != sizeof(stamp))
+      break;
+    lat[i] = div64(tsc2ns(rdtsc() - stamp), 1000);
+  }
+  close(j->fd[0]);
+  // One latency per write: the pipe's free space stays a
+  // multiple of 4, so jobs' values never interleave.
+  for(n = 0; n < i; n++)
+    write(res[1], &lat[n], sizeof(lat[n]));
+  close(res[1]);
+  exit();
+}
+
+void
+sortuint(uint *a, int n)
+{
+  int i, j;
+  uint t;
+
+  for(i = 1; i < n; i++){
+    t = a[i];
+    for(j = i; j > 0 && a[j-1] > t; j--)
+      a[j] = a[j-1];
+    a[j] = t;
+  }
+}
+
+// Jain's index, (sum x)^2 / (n * sum x^2), times 1000,
+// over the shares of the io or the cpu jobs.
+uint
+jain(struct job *jobs, int n, int io)
+{
+  uint64 sum, sq, num, den;
+  int i, k;
+
+  sum = sq = 0;
+  k = 0;
+  for(i = 0; i < n; i++){
+    if(jobs[i].io != io)
+      continue;
+    sum += jobs[i].share;
+    sq += (uint64)jobs[i].share * jobs[i].share;
+    k++;
+  }
+  if(k == 0 || sq == 0)
+    return 1000;
+  num = sum * sum;
+  den = sq * k;
+  // Both fit in 64 bits; scale them until div64 can divide.
+  while(den >> 32 || num >> 54){
+    num >>= 1;
+    den >>= 1;
+  }
+  return div64(num * 1000, den);
+}
+
+void
+snapshot(struct job *jobs, int n)
+{
+  struct proc_stat ps;
+  int i;
+
+  for(i = 0; i < n; i++)
+    if(getpinfo(&ps, jobs[i].pid))
+      jobs[i].share = ps.rtime;
+}
+
+void
+run(int policy, int workload)
+{
+  struct job jobs[NJOB];
+  uint lat[NJOB*ROUNDS];
+  uint start, elapsed, turn;
+  uint64 stamp;
+  int i, r, n, nlat, old, wt, rt, pid;
+
+  old = set_scheduler(policy);
+  if(old < 0){
+    printf(2, "schedbench: set_scheduler %s failed\n", policies[policy]);
+    return;
+  }
+
+  if(pipe(res) < 0){
+    printf(2, "schedbench: pipe failed\n");
+    exit();
+  }
+  start = usnow();
+  for(i = 0; i < NJOB; i++){
+    struct job *j = &jobs[i];
+
+    memset(j, 0, sizeof(*j));
+    j->fd[0] = j->fd[1] = -1;
+    j->io = workload == IO || (workload == MIX && i % 2);
+    if(j->io && pipe(j->fd) < 0){
+      printf(2, "schedbench: pipe failed\n");
+      exit();
+    }
+    j->pid = fork();
+    if(j->pid < 0){
+      printf(2, "schedbench: fork failed\n");
+      exit();
+    }
+    if(j->pid == 0){
+      closeall(j->fd[0]);
+      if(j->io)
+        iojob(j);
+      close(res[1]);
+      cpujob();
+    }
+    if(j->io)
+      close(j->fd[0]);
+  }
+  close(res[1]);
+
+  // Drive the io jobs, sampling cpu shares part way.
+  for(r = 0; r < ROUNDS; r++){
+    if(r == SNAPTICKS){
+      snapshot(jobs, NJOB);
+      if(workload == CPU)
+        break;
+    }
+    sleep(1);
+    for(i = 0; i < NJOB; i++){
+      if(!jobs[i].io)
+        continue;
+      stamp = rdtsc();
+      write(jobs[i].fd[1], &stamp, sizeof(stamp));
+    }
+  }
+  for(i = 0; i < NJOB; i++)
+    if(jobs[i].io)
+      close(jobs[i].fd[1]);
+
+  // Until every io job has exited and closed res[1].
+  nlat = 0;
+  while(nlat < NELEM(lat) &&
+        (n = read(res[0], lat + nlat, (NELEM(lat) - nlat) * sizeof(lat[0]))) > 0)
+    nlat += n / sizeof(lat[0]);
+  close(res[0]);
+
+  turn = 0;
+  for(n = 0; n < NJOB; n++){
+    if((pid = waitx(&wt, &rt)) < 0)
+      break;
+    for(i = 0; i < NJOB; i++)
+      if(jobs[i].pid == pid)
+        jobs[i].turn = usnow() - start;
+  }
+  elapsed = usnow() - start;
+  for(i = 0; i < NJOB; i++)
+    turn += jobs[i].turn;
+  set_scheduler(old);
+
+  sortuint(lat, nlat);
+  printf(1, "CSV,%d,%s,%s,%d,%d,%d,%d,%d,%d,%d\n",
+         ncpu, policies[policy], workloads[workload], NJOB, elapsed,
+         elapsed ? (uint)div64((uint64)NJOB * 100000000, elapsed) : 0,
+         turn / NJOB,
+         nlat ? lat[nlat/2] : 0,
+         nlat ? lat[nlat*99/100] : 0,
+         jain(jobs, NJOB, workload == IO));
+}
+
+int
+lookup(char *name, char **names, int n)
+{
+  int i;
+
+  for(i = 0; i < n; i++)
+    if(strcmp(name, names[i]) == 0)
+      return i;
+  printf(2, "schedbench: unknown %s\n", name);
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct cpu_stat cs[NCPU];
+  int p, w, p0, p1, w0, w1;
+
+  ncpu = cpustat(cs, NCPU);
+  p0 = 0, p1 = NELEM(policies);
+  w0 = 0, w1 = NELEM(workloads);
+  if(argc > 1 && strcmp(argv[1], "all") != 0){
+    p0 = lookup(argv[1], policies, NELEM(policies));
+    p1 = p0 + 1;
+  }
+  if(argc > 2 && strcmp(argv[2], "all") != 0){
+    w0 = lookup(argv[2], workloads, NELEM(workloads));
+    w1 = w0 + 1;
+  }
+
+  printf(1, "%s\n", CSVHDR);
+  for(p = p0; p < p1; p++)
+    for(w = w0; w < w1; w++)
+      run(p, w);
+  printf(1, "schedbench: done\n");
+  exit();
+}
@@ -0,0 +1,215 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "x86.h"
+#include "trace.h"
+
+// usage: schedtrace [-r] [command [args]]
+// Drains the kernel's scheduler trace, running command first
+// if one is given, and draws one row per process: its MLFQ
+// queue (0-4) where it was running, '.' where it was waiting
+// to run, and blank otherwise.  With -r every event is
+// listed instead.
+
+#define MAXEV   (NCPU*TRACESIZE)
+#define WIDTH   64      // columns in the chart
+#define MAXROW  32      // processes in the chart
+
+char *evname[] = {
+[TR_SWITCHIN]  "in",
+[TR_SWITCHOUT] "out",
+[TR_ENQUEUE]   "enq",
+[TR_AGE]       "age",
+[TR_PREEMPT]   "preempt",
+[TR_DROP]      "drop",
+};
+
+struct traceev *ev, *tmp;
+int nev;
+
+struct row {
+  int pid;
+  int runs, preempts, ages;
+  uint runus;     // microseconds on a cpu
+  uint inus;      // when last switched in
+  char cur;       // what the chart shows now
+  int col;        // first column not yet drawn
+  char line[WIDTH+1];
+} rows[MAXROW];
+int nrow;
+
+// Microseconds from t0 to t.
+uint
+us(uint64 t, uint64 t0)
+{
+  return div64(tsc2ns(t - t0), 1000);
+}
+
+// Each cpu's events come out of tracedrain() in order;
+// merge sort them into one timeline.
+void
+sort(void)
+{
+  int w, lo, mid, hi, i, j, k;
+  struct traceev *t;
+
+  for(w = 1; w < nev; w *= 2){
+    for(lo = 0; lo < nev; lo += 2*w){
+      mid = lo + w < nev ? lo + w : nev;
+      hi = lo + 2*w < nev ? lo + 2*w : nev;
+      i = lo, j = mid, k = lo;
+      while(i < mid || j < hi){
+        if(j >= hi || (i < mid && ev[i].tsc <= ev[j].tsc))
+          tmp[k++] = ev[i++];
+        else
+          tmp[k++] = ev[j++];
+      }
+    }
+    t = ev, ev = tmp, tmp = t;
+  }
+}
+
+struct row*
+findrow(int pid)
+{
+  struct row *r;
+
+  for(r = rows; r < &rows[nrow]; r++)
+    if(r->pid == pid)
+      return r;
+  if(nrow == MAXROW)
+    return 0;
+  r = &rows[nrow++];
+  memset(r, 0, sizeof(*r));
+  r->pid = pid;
+  r->cur = ' ';
+  return r;
+}
+
+// Draw r's current state up to column col.  A column where
+// the process ran at all shows the queue it ran in.
+void
+fill(struct row *r, int col)
+{
+  for(; r->col < col; r->col++)
+    if(r->line[r->col] < '0' || r->line[r->col] > '9')
+      r->line[r->col] = r->cur;
+  if(r->cur >= '0' && r->cur <= '9' && col < WIDTH)
+    r->line[col] = r->cur;
+}
+
+void
+listevents(void)
+{
+  struct traceev *e;
+
+  for(e = ev; e < &ev[nev]; e++)
+    printf(1, "%d cpu%d pid %d %s q%d class %d arg %d\n",
+           us(e->tsc, ev[0].tsc), e->cpu, e->pid, evname[e->type],
+           e->queue, e->class, e->arg);
+}
+
+void
+chart(void)
+{
+  struct traceev *e;
+  struct row *r;
+  uint span, t;
+  int col;
+
+  span = us(ev[nev-1].tsc, ev[0].tsc) + 1;
+  for(e = ev; e < &ev[nev]; e++){
+    if(e->type == TR_DROP){
+      printf(1, "cpu%d dropped %d events\n", e->cpu, e->arg);
+      continue;
+    }
+    if((r = findrow(e->pid)) == 0)
+      continue;
+    t = us(e->tsc, ev[0].tsc);
+    col = t / (span / WIDTH + 1);
+    fill(r, col);
+    switch(e->type){
+    case TR_SWITCHIN:
+      r->runs++;
+      r->inus = t;
+      r->cur = '0' + e->queue;
+      break;
+    case TR_SWITCHOUT:
+      r->runus += t - r->inus;
+      r->cur = e->arg ? '.' : ' ';
+      break;
+    case TR_ENQUEUE:
+      r->cur = '.';
+      break;
+    case TR_AGE:
+      r->ages++;
+      break;
+    case TR_PREEMPT:
+      r->preempts++;
+      break;
+    }
+    fill(r, col);
+  }
+
+  printf(1, "%d events over %d us, %d us per column\n",
+         nev, span, span / WIDTH + 1);
+  printf(1, "  pid  runs preempt ages  run us\n");
+  for(r = rows; r < &rows[nrow]; r++){
+    fill(r, WIDTH);
+    r->line[WIDTH] = 0;
+    printf(1, "%d %d %d %d %d |%s|\n", r->pid, r->runs, r->preempts,
+           r->ages, r->runus, r->line);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int raw, n, pid;
+
+  raw = 0;
+  if(argc > 1 && strcmp(argv[1], "-r") == 0){
+    raw = 1;
+    argc--, argv++;
+  }
+  ev = malloc(MAXEV * sizeof(*ev));
+  tmp = malloc(MAXEV * sizeof(*ev));
+  if(ev == 0 || tmp == 0){
+    printf(2, "schedtrace: out of memory\n");
+    exit();
+  }
+
+  if(argc > 1){
+    // Trace only the command.
+    while(tracedrain(ev, MAXEV) > 0)
+      ;
+    pid = fork();
+    if(pid < 0){
+      printf(2, "schedtrace: fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      exec(argv[1], argv+1);
+      printf(2, "schedtrace: exec %s failed\n", argv[1]);
+      exit();
+    }
+    wait();
+  }
+
+  nev = 0;
+  while(nev < MAXEV && (n = tracedrain(ev + nev, MAXEV - nev)) > 0)
+    nev += n;
+  if(nev == 0){
+    printf(1, "no events\n");
+    exit();
+  }
+  sort();
+  if(raw)
+    listevents();
+  else
+    chart();
+  free(ev);
+  free(tmp);
+  exit();
+}
@@ -0,0 +1,302 @@
+// Small object allocator.
+//
+// kmalloc() rounds a request up to one of NKMCLASS power of
+// two size classes, 32 to 2048 bytes, each with its own
+// cache of slabs.  A slab is one page from kalloc() holding
+// objects aligned to their size, with the free ones on a
+// list through their first word.
+//
+// Below KMOFFPAGE bytes the struct slab header sits at the
+// start of the page, in place of the first object, and
+// kmfree() finds it by rounding down to the page.  From
+// KMOFFPAGE up that would waste a quarter or half of the
+// page, so the header is kmalloc()ed on its own and kept in
+// a small hash table keyed by the page.  Objects per page:
+//
+//   size   32  64  128  256  512  1024  2048
+//   objs  127  63   31   15    7     4     2
+//
+// As in kalloc.c, each cpu keeps a magazine of free objects
+// per cache, and only takes the cache's lock to move KMBATCH
+// objects at a time between the magazine and the slabs.  A
+// cache keeps at most one empty slab; others go back to
+// kalloc().
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "pinfoheader.h"
+
+#define KMMIN     32          // smallest size class
+#define KMBATCH   8           // objects moved to or from slabs at once
+#define KMMAG     (2*KMBATCH) // most objects a magazine holds
+#define KMOFFPAGE 1024        // smallest class with off-page headers
+#define NSLABHASH 16          // buckets for off-page headers
+#define SLABMAGIC 0x51ab51ab
+
+struct slab {
+  uint magic;
+  struct kmcache *cache;
+  struct slab *next;     // Partial slabs of the cache
+  struct slab *prev;
+  char *page;            // Objects' page
+  struct slab *hnext;    // Off-page headers in the same bucket
+  void *free;            // Free objects in this slab
+  int inuse;
+};
+
+struct kmcache {
+  struct spinlock lock;
+  uint size;
+  struct slab *partial;  // Slabs with free objects
+  uint nslab;
+  uint nobj;             // Objects allocated from slabs
+  struct {
+    int n;
+    void *obj[KMMAG];
+  } mag[NCPU];           // Only touched by that cpu, interrupts off
+};
+
+static struct kmcache kmcaches[NKMCLASS];
+
+// Off-page headers, by page.  Taken after a cache's lock.
+static struct {
+  struct spinlock lock;
+  struct slab *head[NSLABHASH];
+} offslab;
+
+#define SLABHASH(pg) ((V2P(pg) / PGSIZE) % NSLABHASH)
+
+void
+kmallocinit(void)
+{
+  int i;
+
+  for(i = 0; i < NKMCLASS; i++){
+    initlock(&kmcaches[i].lock, "kmcache");
+    kmcaches[i].size = KMMIN << i;
+  }
+  initlock(&offslab.lock, "offslab");
+}
+
+static struct kmcache*
+kmclass(uint n)
+{
+  int i;
+
+  for(i = 0; i < NKMCLASS; i++)
+    if(n <= kmcaches[i].size)
+      return &kmcaches[i];
+  return 0;
+}
+
+// Bytes kmalloc(n) really takes, or 0 if it cannot.
+uint
+kmsize(uint n)
+{
+  struct kmcache *c;
+
+  if((c = kmclass(n)) == 0)
+    return 0;
+  return c->size;
+}
+
+static void
+unlinkslab(struct kmcache *c, struct slab *s)
+{
+  if(s->prev)
+    s->prev->next = s->next;
+  else
+    c->partial = s->next;
+  if(s->next)
+    s->next->prev = s->prev;
+  s->next = s->prev = 0;
+}
+
+static void
+pushslab(struct kmcache *c, struct slab *s)
+{
+  s->prev = 0;
+  s->next = c->partial;
+  if(s->next)
+    s->next->prev = s;
+  c->partial = s;
+}
+
+// The slab holding object o.
+static struct slab*
+slabof(void *o)
+{
+  struct slab *s;
+  char *pg;
+
+  pg = (char*)PGROUNDDOWN((uint)o);
+  acquire(&offslab.lock);
+  for(s = offslab.head[SLABHASH(pg)]; s; s = s->hnext)
+    if(s->page == pg)
+      break;
+  release(&offslab.lock);
+  if(s == 0)
+    s = (struct slab*)pg;
+  return s;
+}
+
+// Carve a new page into objects for c.
+static struct slab*
+newslab(struct kmcache *c)
+{
+  struct slab *s;
+  char *pg, *o, *first;
+
+  if((pg = kalloc()) == 0)
+    return 0;
+  if(c->size >= KMOFFPAGE){
+    if((s = kmalloc(sizeof(*s))) == 0){
+      kfree(pg);
+      return 0;
+    }
+    s->page = pg;
+    acquire(&offslab.lock);
+    s->hnext = offslab.head[SLABHASH(pg)];
+    offslab.head[SLABHASH(pg)] = s;
+    release(&offslab.lock);
+    first = pg;
+  } else {
+    s = (struct slab*)pg;
+    first = (char*)(s + 1);
+  }
+  s->magic = SLABMAGIC;
+  s->cache = c;
+  s->page = pg;
+  s->free = 0;
+  s->inuse = 0;
+  o = pg + PGSIZE - c->size;
+  for(; o >= first; o -= c->size){
+    *(void**)o = s->free;
+    s->free = o;
+  }
+  pushslab(c, s);
+  c->nslab++;
+  return s;
+}
+
+// Take an object from c's slabs.  Caller holds c->lock.
+static void*
+slaballoc(struct kmcache *c)
+{
+  struct slab *s;
+  void *o;
+
+  if((s = c->partial) == 0 && (s = newslab(c)) == 0)
+    return 0;
+  o = s->free;
+  s->free = *(void**)o;
+  s->inuse++;
+  if(s->free == 0)
+    unlinkslab(c, s);  // full
+  c->nobj++;
+  return o;
+}
+
+// Give o back to its slab.  Caller holds c->lock.
+static void
+slabfree(struct kmcache *c, void *o)
+{
+  struct slab *s, **pp;
+
+  s = slabof(o);
+  if(s->free == 0)
+    pushslab(c, s);  // was full
+  *(void**)o = s->free;
+  s->free = o;
+  s->inuse--;
+  c->nobj--;
+  if(s->inuse == 0 && (s->prev || s->next)){
+    unlinkslab(c, s);
+    s->magic = 0;
+    if(s->page == (char*)s)
+      kfree((char*)s);
+    else {
+      acquire(&offslab.lock);
+      for(pp = &offslab.head[SLABHASH(s->page)]; *pp != s; pp = &(*pp)->hnext)
+        ;
+      *pp = s->hnext;
+      release(&offslab.lock);
+      kfree(s->page);
+      kmfree(s);
+    }
+    c->nslab--;
+  }
+}
+
+// Allocate n bytes, at most 2048, aligned to the size class.
+// Returns 0 if the memory cannot be allocated.
+void*
+kmalloc(uint n)
+{
+  struct kmcache *c;
+  void *o;
+  int id;
+
+  if((c = kmclass(n)) == 0)
+    return 0;
+  pushcli();
+  id = cpuid();
+  if(c->mag[id].n == 0){
+    acquire(&c->lock);
+    while(c->mag[id].n < KMBATCH && (o = slaballoc(c)) != 0)
+      c->mag[id].obj[c->mag[id].n++] = o;
+    release(&c->lock);
+  }
+  o = 0;
+  if(c->mag[id].n > 0)
+    o = c->mag[id].obj[--c->mag[id].n];
+  popcli();
+  return o;
+}
+
+// Free an object from kmalloc().
+void
+kmfree(void *o)
+{
+  struct slab *s;
+  struct kmcache *c;
+  int id;
+
+  s = slabof(o);
+  if(s->magic != SLABMAGIC || ((uint)o - (uint)s->page) % s->cache->size)
+    panic("kmfree");
+  c = s->cache;
+  pushcli();
+  id = cpuid();
+  if(c->mag[id].n == KMMAG){
+    acquire(&c->lock);
+    while(c->mag[id].n > KMMAG - KMBATCH)
+      slabfree(c, c->mag[id].obj[--c->mag[id].n]);
+    release(&c->lock);
+  }
+  c->mag[id].obj[c->mag[id].n++] = o;
+  popcli();
+}
+
+// Fill in st's slab numbers for each size class.
+void
+kmallocstat(struct mem_stat *st)
+{
+  struct kmcache *c;
+  int i, k;
+
+  for(i = 0; i < NKMCLASS; i++){
+    c = &kmcaches[i];
+    acquire(&c->lock);
+    st->kmsize[i] = c->size;
+    st->kmslabs[i] = c->nslab;
+    st->kmobjs[i] = c->nobj;
+    release(&c->lock);
+    for(k = 0; k < NCPU; k++)
+      st->kmobjs[i] -= c->mag[k].n;
+  }
+}
@@ -6,28 +6,53 @@
 #include "x86.h"
 #include "memlayout.h"
 #include "mmu.h"
-#include "proc.h"
 #include "spinlock.h"
+#include "proc.h"
 #include "sleeplock.h"
 
+// Lend a waiter's priority to the holder (see acquiresleep).
+#ifndef SLEEPLOCK_PI
+#define SLEEPLOCK_PI 1
+#endif
+
 void
 initsleeplock(struct sleeplock *lk, char *name)
 {
   initlock(&lk->lk, "sleep lock");
   lk->name = name;
   lk->locked = 0;
+  lk->holder = 0;
   lk->pid = 0;
 }
 
+// A process waiting on a holder of worse priority is a
+// priority inversion: under PBS, processes in between can
+// keep the holder, and so the waiter, off the cpu for good.
+// The holder runs at the waiter's priority until it has
+// released all its sleeplocks, and the waiter is charged
+// the time in p->invtsc.
 void
 acquiresleep(struct sleeplock *lk)
 {
+  struct proc *p = myproc();
+  uint64 t0 = 0;
+
   acquire(&lk->lk);
   while (lk->locked) {
+    if(pbsprio(lk->holder) > pbsprio(p)){
+      if(t0 == 0)
+        t0 = rdtsc();
+      if(SLEEPLOCK_PI)
+        prioboost(lk->holder, pbsprio(p));
+    }
     sleep(lk, &lk->lk);
   }
+  if(t0)
+    p->invtsc += rdtsc() - t0;
   lk->locked = 1;
-  lk->pid = myproc()->pid;
+  lk->holder = p;
+  lk->pid = p->pid;
+  p->nsleeplock++;
   release(&lk->lk);
 }
 
@@ -35,7 +60,10 @@ void
 releasesleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
+  if(--lk->holder->nsleeplock == 0)
+    priorestore(lk->holder);
   lk->locked = 0;
+  lk->holder = 0;
   lk->pid = 0;
   wakeup(lk);
   release(&lk->lk);
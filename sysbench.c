@@ -0,0 +1,80 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+#include "sched.h"
+
+// usage: sysbench [iterations]
+// Under PBS, with a spinning process of worse priority on
+// the machine, reports the mean cycles for a null system
+// call (getpid) and for a pipe round trip between two
+// processes, which wakes the other side on every call.
+
+#define NHOG 2
+
+uint
+cycles(uint64 t0, int n)
+{
+  return div64(rdtsc() - t0, n);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, n, old, pid;
+  int hogs[NHOG];
+  int a[2], b[2];
+  uint64 t0;
+  char c;
+
+  n = 100000;
+  if(argc > 1)
+    n = atoi(argv[1]);
+  if(n <= 0)
+    n = 1;
+
+  old = set_scheduler(SCHED_PBS);
+  set_priority(10, getpid());
+  for(i = 0; i < NHOG; i++){
+    if((hogs[i] = fork()) == 0){
+      set_priority(90, getpid());
+      for(;;)
+        ;
+    }
+  }
+
+  t0 = rdtsc();
+  for(i = 0; i < n; i++)
+    getpid();
+  printf(1, "getpid:    %d cycles\n", cycles(t0, n));
+
+  if(pipe(a) < 0 || pipe(b) < 0){
+    printf(2, "sysbench: pipe failed\n");
+    exit();
+  }
+  n /= 10;
+  if(n == 0)
+    n = 1;
+  pid = fork();
+  if(pid == 0){
+    for(i = 0; i < n; i++){
+      read(a[0], &c, 1);
+      write(b[1], &c, 1);
+    }
+    exit();
+  }
+  t0 = rdtsc();
+  for(i = 0; i < n; i++){
+    write(a[1], &c, 1);
+    read(b[0], &c, 1);
+  }
+  printf(1, "pipe rtt:  %d cycles\n", cycles(t0, n));
+  wait();
+
+  for(i = 0; i < NHOG; i++)
+    kill(hogs[i]);
+  for(i = 0; i < NHOG; i++)
+    wait();
+  set_scheduler(old);
+  exit();
+}
@@ -3,6 +3,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "x86.h"
 #include "syscall.h"
@@ -20,7 +21,7 @@ fetchint(uint addr, int *ip)
 {
   struct proc *curproc = myproc();
 
-  if(addr >= curproc->sz || addr+4 > curproc->sz)
+  if(addr >= curproc->vm->sz || addr+4 > curproc->vm->sz)
     return -1;
   *ip = *(int*)(addr);
   return 0;
@@ -35,10 +36,10 @@ fetchstr(uint addr, char **pp)
   char *s, *ep;
   struct proc *curproc = myproc();
 
-  if(addr >= curproc->sz)
+  if(addr >= curproc->vm->sz)
     return -1;
   *pp = (char*)addr;
-  ep = (char*)curproc->sz;
+  ep = (char*)curproc->vm->sz;
   for(s = *pp; s < ep; s++){
     if(*s == 0)
       return s - *pp;
@@ -64,7 +65,7 @@ argptr(int n, char **pp, int size)
  
   if(argint(n, &i) < 0)
     return -1;
-  if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
+  if(size < 0 || (uint)i >= curproc->vm->sz || (uint)i+size > curproc->vm->sz)
     return -1;
   *pp = (char*)i;
   return 0;
@@ -107,6 +108,21 @@ extern int sys_uptime(void);
 extern int sys_waitx(void);
 extern int sys_set_priority(void);
 extern int sys_getpinfo(void);
+extern int sys_set_scheduler(void);
+extern int sys_get_scheduler(void);
+extern int sys_set_sched_class(void);
+extern int sys_settickets(void);
+extern int sys_set_edf(void);
+extern int sys_cpustat(void);
+extern int sys_clock_gettime(void);
+extern int sys_tracedrain(void);
+extern int sys_sched_setaffinity(void);
+extern int sys_sched_getaffinity(void);
+extern int sys_clone(void);
+extern int sys_join(void);
+extern int sys_futex_wait(void);
+extern int sys_futex_wake(void);
+extern int sys_memstat(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -133,6 +149,21 @@ static int (*syscalls[])(void) = {
 [SYS_waitx]   sys_waitx,
 [SYS_set_priority]  sys_set_priority,
 [SYS_getpinfo]  sys_getpinfo, 
+[SYS_set_scheduler]  sys_set_scheduler,
+[SYS_get_scheduler]  sys_get_scheduler,
+[SYS_set_sched_class]  sys_set_sched_class,
+[SYS_settickets]  sys_settickets,
+[SYS_set_edf]  sys_set_edf,
+[SYS_cpustat]  sys_cpustat,
+[SYS_clock_gettime]  sys_clock_gettime,
+[SYS_tracedrain]  sys_tracedrain,
+[SYS_sched_setaffinity]  sys_sched_setaffinity,
+[SYS_sched_getaffinity]  sys_sched_getaffinity,
+[SYS_clone]  sys_clone,
+[SYS_join]  sys_join,
+[SYS_futex_wait]  sys_futex_wait,
+[SYS_futex_wake]  sys_futex_wake,
+[SYS_memstat]  sys_memstat,
 };
 
 void
@@ -23,3 +23,18 @@
 #define SYS_waitx  22
 #define SYS_set_priority	23
 #define SYS_getpinfo    24
+#define SYS_set_scheduler 25
+#define SYS_get_scheduler 26
+#define SYS_set_sched_class 27
+#define SYS_settickets 28
+#define SYS_set_edf 29
+#define SYS_cpustat 30
+#define SYS_clock_gettime 31
+#define SYS_tracedrain 32
+#define SYS_sched_setaffinity 33
+#define SYS_sched_getaffinity 34
+#define SYS_clone 35
+#define SYS_join 36
+#define SYS_futex_wait 37
+#define SYS_futex_wake 38
+#define SYS_memstat 39
@@ -5,8 +5,10 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "pinfoheader.h"
+#include "trace.h"
 
 int
 sys_fork(void)
@@ -46,36 +48,23 @@ sys_getpid(void)
 int
 sys_sbrk(void)
 {
-  int addr;
   int n;
 
   if(argint(0, &n) < 0)
     return -1;
-  addr = myproc()->sz;
-  if(growproc(n) < 0)
-    return -1;
-  return addr;
+  return growproc(n);
 }
 
 int
 sys_sleep(void)
 {
   int n;
-  uint ticks0;
 
   if(argint(0, &n) < 0)
     return -1;
-  acquire(&tickslock);
-  ticks0 = ticks;
-  while(ticks - ticks0 < n){
-    if(myproc()->killed){
-      release(&tickslock);
-      return -1;
-    }
-    sleep(&ticks, &tickslock);
-  }
-  release(&tickslock);
-  return 0;
+  if(n <= 0)
+    return myproc()->killed ? -1 : 0;
+  return sleep_until(ticks + n);
 }
 
 // return how many clock tick interrupts have occurred
@@ -135,3 +124,179 @@ sys_getpinfo(void)
     
     return getpinfo(pinfo_proc, pid);
 }
+
+int
+sys_set_scheduler(void)
+{
+  int policy;
+
+  if(argint(0, &policy) < 0)
+    return -1;
+  return setscheduler(policy);
+}
+
+int
+sys_get_scheduler(void)
+{
+  return getscheduler();
+}
+
+int
+sys_set_sched_class(void)
+{
+  int pid, policy;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  if(argint(1, &policy) < 0)
+    return -1;
+  return set_sched_class(pid, policy);
+}
+
+int
+sys_settickets(void)
+{
+  int pid, n;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  if(argint(1, &n) < 0)
+    return -1;
+  return settickets(pid, n);
+}
+
+// Run the caller under EDF with budget ticks every period
+// ticks, or take it out of EDF if both are 0.
+int
+sys_set_edf(void)
+{
+  int period, budget;
+
+  if(argint(0, &period) < 0)
+    return -1;
+  if(argint(1, &budget) < 0)
+    return -1;
+  if(edfset(myproc(), period, budget) < 0)
+    return -1;
+  yield();  // requeue under the new class
+  return 0;
+}
+
+int
+sys_cpustat(void)
+{
+  int n;
+  struct cpu_stat *st;
+
+  if(argint(1, &n) < 0 || n < 0 || n > NCPU)
+    return -1;
+  if(argptr(0, (char**)&st, n*sizeof(struct cpu_stat)) < 0)
+    return -1;
+  return getcpustats(st, n);
+}
+
+int
+sys_clock_gettime(void)
+{
+  int clk;
+  uint64 ns;
+  struct timespec *ts;
+
+  if(argint(0, &clk) < 0 || clk != CLOCK_MONOTONIC)
+    return -1;
+  if(argptr(1, (char**)&ts, sizeof(*ts)) < 0)
+    return -1;
+  ns = nsnow();
+  ts->sec = div64(ns, 1000000000);
+  ts->nsec = ns - (uint64)ts->sec * 1000000000;
+  return 0;
+}
+
+int
+sys_tracedrain(void)
+{
+  int n;
+  struct traceev *ev;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -1;
+  if(argptr(0, (char**)&ev, n*sizeof(struct traceev)) < 0)
+    return -1;
+  return tracedrain(ev, n);
+}
+
+int
+sys_sched_setaffinity(void)
+{
+  int pid, mask;
+
+  if(argint(0, &pid) < 0 || argint(1, &mask) < 0)
+    return -1;
+  return setaffinity(pid, mask);
+}
+
+int
+sys_sched_getaffinity(void)
+{
+  int pid;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  return getaffinity(pid);
+}
+
+int
+sys_clone(void)
+{
+  int fn, stack, arg;
+
+  if(argint(0, &fn) < 0 || argint(1, &stack) < 0 || argint(2, &arg) < 0)
+    return -1;
+  return clone(fn, stack, arg);
+}
+
+int
+sys_join(void)
+{
+  uint *stack;
+
+  if(argptr(0, (char**)&stack, sizeof(*stack)) < 0)
+    return -1;
+  return join(stack);
+}
+
+int
+sys_futex_wait(void)
+{
+  char *addr;
+  int val;
+
+  if(argptr(0, &addr, sizeof(uint)) < 0 || argint(1, &val) < 0)
+    return -1;
+  return futexwait((uint)addr, val);
+}
+
+int
+sys_futex_wake(void)
+{
+  char *addr;
+  int n;
+
+  if(argptr(0, &addr, sizeof(uint)) < 0 || argint(1, &n) < 0)
+    return -1;
+  return futexwake((uint)addr, n);
+}
+
+int
+sys_memstat(void)
+{
+  struct mem_stat *st;
+
+  if(argptr(0, (char**)&st, sizeof(*st)) < 0)
+    return -1;
+  kmemstat(st);
+  kmallocstat(st);
+  st->pipebytes = pipebytes();
+  st->filebytes = filebytes();
+  return 0;
+}
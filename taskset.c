@@ -0,0 +1,64 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// usage: taskset mask command [args]
+//        taskset -p pid [mask]
+// Runs command on the cpus in mask (bit i for cpu i, in
+// hex with a 0x prefix or decimal), or shows or sets the
+// cpus process pid may run on.
+
+uint
+parsemask(char *s)
+{
+  uint m;
+  int d;
+
+  if(s[0] != '0' || (s[1] != 'x' && s[1] != 'X'))
+    return atoi(s);
+  m = 0;
+  for(s += 2; *s; s++){
+    if(*s >= '0' && *s <= '9')
+      d = *s - '0';
+    else if(*s >= 'a' && *s <= 'f')
+      d = *s - 'a' + 10;
+    else if(*s >= 'A' && *s <= 'F')
+      d = *s - 'A' + 10;
+    else
+      break;
+    m = m*16 + d;
+  }
+  return m;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid, mask;
+
+  if(argc >= 3 && strcmp(argv[1], "-p") == 0){
+    pid = atoi(argv[2]);
+    if(argc > 3 && sched_setaffinity(pid, parsemask(argv[3])) < 0){
+      printf(2, "taskset: cannot set pid %d to %s\n", pid, argv[3]);
+      exit();
+    }
+    if((mask = sched_getaffinity(pid)) < 0){
+      printf(2, "taskset: no pid %d\n", pid);
+      exit();
+    }
+    printf(1, "pid %d: 0x%x\n", pid, mask);
+    exit();
+  }
+  if(argc < 3){
+    printf(2, "usage: taskset mask command [args]\n"
+              "       taskset -p pid [mask]\n");
+    exit();
+  }
+  if(sched_setaffinity(getpid(), parsemask(argv[1])) < 0){
+    printf(2, "taskset: bad mask %s\n", argv[1]);
+    exit();
+  }
+  exec(argv[2], argv+2);
+  printf(2, "taskset: exec %s failed\n", argv[2]);
+  exit();
+}
@@ -0,0 +1,61 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "pinfoheader.h"
+
+// usage: tickbench [nsleepers]
+// Reports the mean cycles each timer interrupt costs cpu 0,
+// which does the wakeups, first with nothing sleeping and
+// then with nsleepers (default 60) processes in sleep().
+// The count printed is how many could actually be forked.
+
+#define WINDOW 100  // ticks to measure over
+
+int
+pertick(void)
+{
+  struct cpu_stat a, b;
+
+  if(cpustat(&a, 1) != 1)
+    return -1;
+  sleep(WINDOW);
+  if(cpustat(&b, 1) != 1 || b.ticks == a.ticks)
+    return -1;
+  return (b.tickcyc - a.tickcyc) / (b.ticks - a.ticks);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, n, pid;
+  int pids[NPROC];
+
+  n = 60;
+  if(argc > 1)
+    n = atoi(argv[1]);
+  if(n < 0 || n > NPROC - 3)
+    n = NPROC - 3;  // all but init, sh and tickbench
+
+  printf(1, "0 sleepers: %d cycles/tick\n", pertick());
+
+  for(i = 0; i < n; i++){
+    pid = fork();
+    if(pid < 0)
+      break;
+    if(pid == 0){
+      sleep(100 * WINDOW);
+      exit();
+    }
+    pids[i] = pid;
+  }
+  n = i;
+  sleep(1);  // let the children get to sleep
+  printf(1, "%d sleepers: %d cycles/tick\n", n, pertick());
+
+  for(i = 0; i < n; i++)
+    kill(pids[i]);
+  for(i = 0; i < n; i++)
+    wait();
+  exit();
+}
@@ -0,0 +1,52 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+#include "date.h"
+
+// usage: timebench [iterations]
+// Reports the mean cycles per call of each way to read the
+// time: the uptime() and clock_gettime() system calls, and
+// their time page counterparts tpticks() and tpclock().
+
+uint
+cycles(uint64 t0, int n)
+{
+  return div64(rdtsc() - t0, n);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, n;
+  uint64 t0;
+  struct timespec ts;
+
+  n = 100000;
+  if(argc > 1)
+    n = atoi(argv[1]);
+  if(n <= 0)
+    n = 1;
+
+  t0 = rdtsc();
+  for(i = 0; i < n; i++)
+    uptime();
+  printf(1, "uptime:        %d cycles\n", cycles(t0, n));
+
+  t0 = rdtsc();
+  for(i = 0; i < n; i++)
+    tpticks();
+  printf(1, "tpticks:       %d cycles\n", cycles(t0, n));
+
+  t0 = rdtsc();
+  for(i = 0; i < n; i++)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+  printf(1, "clock_gettime: %d cycles\n", cycles(t0, n));
+
+  t0 = rdtsc();
+  for(i = 0; i < n; i++)
+    tpclock(&ts);
+  printf(1, "tpclock:       %d cycles\n", cycles(t0, n));
+
+  exit();
+}
@@ -0,0 +1,130 @@
+// Hierarchical timer wheel.
+//
+// Level 0 has one slot for each of the next 64 ticks.  Each
+// higher level has 64 slots, each spanning 64 slots of the
+// level below.  A timer is filed by how far off it is and
+// moved down a level (cascaded) when the wheel reaches its
+// slot, so a tick only touches the timers that are due and
+// each timer is moved at most NLEVEL times.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+
+#define WHEELBITS 6
+#define WHEELSIZE (1 << WHEELBITS)
+#define WHEELMASK (WHEELSIZE - 1)
+#define NLEVEL    4
+#define MAXDELTA  ((1U << (WHEELBITS*NLEVEL)) - 1)
+
+// Lock order is wheel.lock, then the sleep queues.
+static struct {
+  struct spinlock lock;
+  uint now;                               // Last tick processed
+  struct timer *slot[NLEVEL][WHEELSIZE];
+} wheel;
+
+void
+timerinit(void)
+{
+  initlock(&wheel.lock, "timer");
+}
+
+// Put t in the slot for t->expires.  A timer already due
+// goes in the current slot.  Caller must hold wheel.lock.
+static void
+timerfile(struct timer *t)
+{
+  struct timer **head;
+  uint delta, e;
+  int lvl;
+
+  delta = t->expires - wheel.now;
+  if((int)delta <= 0){
+    head = &wheel.slot[0][wheel.now & WHEELMASK];
+  } else {
+    // Timers beyond the top level wait in its farthest
+    // slot and are filed again when it comes round.
+    if(delta > MAXDELTA)
+      delta = MAXDELTA;
+    e = wheel.now + delta;
+    for(lvl = 0; lvl < NLEVEL-1; lvl++)
+      if(delta < 1U << (WHEELBITS*(lvl+1)))
+        break;
+    head = &wheel.slot[lvl][(e >> (WHEELBITS*lvl)) & WHEELMASK];
+  }
+  t->next = *head;
+  if(t->next)
+    t->next->pprev = &t->next;
+  t->pprev = head;
+  *head = t;
+}
+
+static void
+timerunlink(struct timer *t)
+{
+  *t->pprev = t->next;
+  if(t->next)
+    t->next->pprev = t->pprev;
+  t->next = 0;
+  t->pprev = 0;
+}
+
+// Bring the wheel up to ticks, waking the sleeper of every
+// timer that expires.  Called by cpu 0 once per tick.
+void
+timertick(void)
+{
+  struct timer *t, *next;
+  struct timer **head;
+  int lvl;
+
+  acquire(&wheel.lock);
+  while(wheel.now != ticks){
+    wheel.now++;
+    // Cascade each level whose slot boundary was just crossed.
+    for(lvl = 1; lvl < NLEVEL; lvl++){
+      if(wheel.now & ((1U << (WHEELBITS*lvl)) - 1))
+        break;
+      head = &wheel.slot[lvl][(wheel.now >> (WHEELBITS*lvl)) & WHEELMASK];
+      t = *head;
+      *head = 0;
+      for(; t; t = next){
+        next = t->next;
+        timerfile(t);
+      }
+    }
+    head = &wheel.slot[0][wheel.now & WHEELMASK];
+    while((t = *head) != 0){
+      timerunlink(t);
+      wakeup(t);
+    }
+  }
+  release(&wheel.lock);
+}
+
+// Sleep until ticks reaches deadline.
+// Returns 0, or -1 if the process was killed first.
+int
+sleep_until(uint deadline)
+{
+  struct proc *p = myproc();
+  struct timer *t = &p->timer;
+
+  acquire(&wheel.lock);
+  if((int)(deadline - ticks) > 0){
+    t->expires = deadline;
+    timerfile(t);
+    while(t->pprev && !p->killed)
+      sleep(t, &wheel.lock);
+    if(t->pprev)
+      timerunlink(t);
+  }
+  release(&wheel.lock);
+  return p->killed ? -1 : 0;
+}
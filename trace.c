@@ -0,0 +1,100 @@
+// Scheduler event trace.
+//
+// Each cpu appends to its own ring with interrupts off, so
+// recording an event takes no lock and never waits.  A ring
+// has one producer (its cpu) and one consumer (tracedrain,
+// serialized by tracelock): the producer only writes head
+// and the consumer only writes tail.  When a ring is full
+// new events are counted and dropped.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "trace.h"
+
+static struct ring {
+  volatile uint head;       // Next slot to fill
+  volatile uint tail;       // Next slot to drain
+  volatile uint drops;      // Events dropped so far
+  uint reported;            // Drops already reported
+  struct traceev ev[TRACESIZE];
+} rings[NCPU];
+
+static struct spinlock tracelock;
+
+void
+traceinit(void)
+{
+  initlock(&tracelock, "trace");
+}
+
+void
+trace(int type, struct proc *p, int arg)
+{
+  struct ring *r;
+  struct traceev *e;
+  uint h;
+
+  pushcli();
+  r = &rings[cpuid()];
+  h = r->head;
+  if(h - r->tail >= TRACESIZE){
+    r->drops++;
+    popcli();
+    return;
+  }
+  e = &r->ev[h & (TRACESIZE-1)];
+  e->tsc = rdtsc();
+  e->pid = p->pid;
+  e->type = type;
+  e->cpu = r - rings;
+  e->queue = p->queue;
+  e->class = p->rqclass;
+  e->arg = arg;
+  // Fill the slot before publishing it.
+  __sync_synchronize();
+  r->head = h + 1;
+  popcli();
+}
+
+// Move up to n events into ev, oldest first within each cpu.
+// A TR_DROP event reports any lost since the last drain.
+// Returns the number moved.
+int
+tracedrain(struct traceev *ev, int n)
+{
+  struct ring *r;
+  struct traceev *e;
+  uint h, t, d;
+  int i;
+
+  i = 0;
+  acquire(&tracelock);
+  for(r = rings; r < &rings[ncpu] && i < n; r++){
+    d = r->drops;
+    if(d != r->reported){
+      e = &ev[i++];
+      memset(e, 0, sizeof(*e));
+      e->tsc = rdtsc();
+      e->type = TR_DROP;
+      e->cpu = r - rings;
+      e->arg = d - r->reported;
+      r->reported = d;
+    }
+    h = r->head;
+    // Read head before the slots it covers.
+    __sync_synchronize();
+    for(t = r->tail; t != h && i < n; t++)
+      ev[i++] = r->ev[t & (TRACESIZE-1)];
+    // Done with the slots before handing them back.
+    __sync_synchronize();
+    r->tail = t;
+  }
+  release(&tracelock);
+  return i;
+}
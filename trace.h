@@ -0,0 +1,22 @@
+// Scheduler trace events, drained by tracedrain().
+
+#define TRACESIZE 1024      // Events per cpu ring, a power of 2
+
+// Event types
+#define TR_SWITCHIN  1      // arg: run queue length left behind
+#define TR_SWITCHOUT 2      // arg: 1 if still RUNNABLE, else 0
+#define TR_ENQUEUE   3      // arg: cpu whose queue it joined
+#define TR_AGE       4      // MLFQ promotion; queue is the new level
+#define TR_PREEMPT   5      // Forced off the cpu by yield()
+#define TR_DROP      6      // arg: events lost to a full ring
+
+struct traceev {
+  uint64 tsc;               // rdtsc() when it happened
+  int pid;
+  uchar type;
+  uchar cpu;
+  uchar queue;              // MLFQ level (p->queue)
+  uchar class;              // p->rqclass
+  int arg;
+  int pad;
+};
@@ -3,10 +3,10 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "x86.h"
 #include "traps.h"
-#include "spinlock.h"
 
 // Interrupt descriptor table (shared by all CPUs).
 struct gatedesc idt[256];
@@ -36,6 +36,8 @@ idtinit(void)
 void
 trap(struct trapframe *tf)
 {
+  uint64 t0;
+
   if(tf->trapno == T_SYSCALL){
     if(myproc()->killed)
       exit();
@@ -43,18 +45,31 @@ trap(struct trapframe *tf)
     syscall();
     if(myproc()->killed)
       exit();
+    // The call may have woken a process that should run first.
+    if(schedpreempt(myproc(), 0))
+      yield();
     return;
   }
 
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
+    t0 = rdtsc();
     if(cpuid() == 0){
       acquire(&tickslock);
       ticks++;
-      update_proc_time();
-      wakeup(&ticks);
       release(&tickslock);
+      clocktick();
+      timertick();
     }
+    schedtick();
+    rebalance();
+    lapiceoi();
+    mycpu()->ntick++;
+    mycpu()->tickcyc += rdtsc() - t0;
+    break;
+  case T_IRQ0 + IRQ_RESCHED:
+    // Only wakes this cpu from schedidle().
+    mycpu()->nipi++;
     lapiceoi();
     break;
   case T_IRQ0 + IRQ_IDE:
@@ -101,38 +116,13 @@ trap(struct trapframe *tf)
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
     exit();
 
-  // Force process to give up CPU on clock tick.
+  // Force process to give up CPU when its scheduling class says so.
   // If interrupts were on while locks held, would need to check nlock.
-  #ifndef FCFS
+  if(myproc() && myproc()->state == RUNNING &&
+     schedpreempt(myproc(), tf->trapno == T_IRQ0+IRQ_TIMER))
+    yield();
 
-    #ifdef ROUND_ROBIN
-    if(myproc() && myproc()->state == RUNNING && tf->trapno == T_IRQ0+IRQ_TIMER){
-      // enQueue(myproc()->queue, myproc());
-      yield();
-    }
-
-    #else
-    #ifdef MLFQ
-      if(myproc() && myproc()->state == RUNNING && myproc()->queue != 4 && myproc()->curTime > qticks[myproc()->queue]){
-        
-        // enQueue(myproc()->queue, myproc());
-        yield();
-      }
-    #else
-      if(myproc() && myproc()->state == RUNNING){
-        if(tf->trapno == T_IRQ0+IRQ_TIMER) {
-          if(higherPriority(myproc()->priority, 1))
-            yield();
-        }
-        else {
-          if(higherPriority(myproc()->priority, 0));
-            yield();
-        }
-      }
-    #endif
-    #endif
-    // Check if the process has been killed since we yielded
-    if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
-      exit();
-  #endif
+  // Check if the process has been killed since we yielded
+  if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
+    exit();
 }
@@ -1,13 +1,8 @@
 typedef unsigned int   uint;
 typedef unsigned short ushort;
 typedef unsigned char  uchar;
+typedef unsigned long long uint64;
 typedef uint pde_t;
 
 #define maxage 30
-int qSize[5];
-int front[5], rear[5], qticks[5];
-struct proc* q[5][100];
-int isFull(int);
-int isEmpty(int);
-void enQueue(int, struct proc*);
-struct proc* deQueue(int);
\ No newline at end of file
+int qticks[5];
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "fcntl.h"
 #include "user.h"
 #include "x86.h"
+#include "date.h"
+#include "memlayout.h"
 
 char*
 strcpy(char *s, const char *t)
@@ -104,3 +106,32 @@ memmove(void *vdst, const void *vsrc, int n)
     *dst++ = *src++;
   return vdst;
 }
+
+// Like uptime() and clock_gettime(CLOCK_MONOTONIC), but read
+// from the kernel's time page without a system call.
+uint
+tpticks(void)
+{
+  return ((struct timepage*)TIMEPAGE)->ticks;
+}
+
+// Nanoseconds in c TSC cycles.
+uint64
+tsc2ns(uint64 c)
+{
+  struct timepage *tp = (struct timepage*)TIMEPAGE;
+
+  return ((uint64)(uint)c * tp->tscmult >> TSCSHIFT) +
+         ((uint64)(uint)(c >> 32) * tp->tscmult << (32 - TSCSHIFT));
+}
+
+void
+tpclock(struct timespec *ts)
+{
+  struct timepage *tp = (struct timepage*)TIMEPAGE;
+  uint64 ns;
+
+  ns = tsc2ns(rdtsc() - tp->tscboot);
+  ts->sec = div64(ns, 1000000000);
+  ts->nsec = ns - (uint64)ts->sec * 1000000000;
+}
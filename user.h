@@ -1,6 +1,23 @@
 struct stat;
 struct rtcdate;
 struct proc_stat;
+struct cpu_stat;
+struct mem_stat;
+struct timespec;
+struct traceev;
+
+// uthread.c locks
+struct spin {
+  uint locked;
+};
+
+struct mutex {
+  volatile uint v;
+};
+
+struct cond {
+  volatile uint seq;
+};
 
 // system calls
 int fork(void);
@@ -27,6 +44,21 @@ int uptime(void);
 int waitx(int*, int*);
 int set_priority(int, int);
 int getpinfo(struct proc_stat*, int);
+int set_scheduler(int);
+int get_scheduler(void);
+int set_sched_class(int, int);
+int settickets(int, int);
+int set_edf(int, int);
+int cpustat(struct cpu_stat*, int);
+int clock_gettime(int, struct timespec*);
+int tracedrain(struct traceev*, int);
+int sched_setaffinity(int, uint);
+int sched_getaffinity(int);
+int clone(void(*)(void*), void*, void*);
+int join(void**);
+int futex_wait(volatile uint*, uint);
+int futex_wake(volatile uint*, int);
+int memstat(struct mem_stat*);
 
 // ulib.c
 int stat(const char*, struct stat*);
@@ -41,3 +73,20 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+uint tpticks(void);
+void tpclock(struct timespec*);
+uint64 tsc2ns(uint64);
+
+// uthread.c
+int thread_create(void (*)(void*), void*);
+int thread_join(void);
+void spin_init(struct spin*);
+void spin_lock(struct spin*);
+void spin_unlock(struct spin*);
+void mutex_init(struct mutex*);
+void mutex_lock(struct mutex*);
+void mutex_unlock(struct mutex*);
+void cond_init(struct cond*);
+void cond_wait(struct cond*, struct mutex*);
+void cond_signal(struct cond*);
+void cond_broadcast(struct cond*);
@@ -0,0 +1,134 @@
+#include "types.h"
+#include "user.h"
+#include "x86.h"
+#include "mmu.h"
+
+// Threads on clone() and join(), and locks for them.  thread_create() and
+// thread_join() use malloc, which is not thread safe, so
+// call them from one thread.
+
+static void
+threadstart(void *stack)
+{
+  uint *s = stack;
+
+  ((void (*)(void*))s[0])((void*)s[1]);
+  exit();
+}
+
+// Run fn(arg) in a new thread; returns its pid or -1.
+int
+thread_create(void (*fn)(void*), void *arg)
+{
+  uint *stack;
+  int pid;
+
+  if((stack = malloc(PGSIZE)) == 0)
+    return -1;
+  // The stack grows down towards these; threadstart
+  // reads them before it can.
+  stack[0] = (uint)fn;
+  stack[1] = (uint)arg;
+  if((pid = clone(threadstart, stack, stack)) < 0)
+    free(stack);
+  return pid;
+}
+
+// Wait for a thread to finish; returns its pid or -1.
+int
+thread_join(void)
+{
+  void *stack;
+  int pid;
+
+  if((pid = join(&stack)) >= 0)
+    free(stack);
+  return pid;
+}
+
+void
+spin_init(struct spin *lk)
+{
+  lk->locked = 0;
+}
+
+void
+spin_lock(struct spin *lk)
+{
+  while(xchg(&lk->locked, 1) != 0)
+    ;
+}
+
+void
+spin_unlock(struct spin *lk)
+{
+  xchg(&lk->locked, 0);
+}
+
+// Mutex on futex_wait/futex_wake, after Drepper's
+// "Futexes Are Tricky": v is 0 when unlocked, 1 when
+// locked and 2 when locked with possible waiters, so an
+// uncontended lock and unlock make no system call.
+
+void
+mutex_init(struct mutex *m)
+{
+  m->v = 0;
+}
+
+void
+mutex_lock(struct mutex *m)
+{
+  uint c;
+
+  if((c = cmpxchg(&m->v, 0, 1)) == 0)
+    return;
+  if(c != 2)
+    c = xchg(&m->v, 2);
+  while(c != 0){
+    futex_wait(&m->v, 2);
+    c = xchg(&m->v, 2);
+  }
+}
+
+void
+mutex_unlock(struct mutex *m)
+{
+  if(xchg(&m->v, 0) == 2)
+    futex_wake(&m->v, 1);
+}
+
+// Condition variable.  seq changes on every signal, so a
+// waiter that unlocked m before a signal came does not
+// sleep through it.
+
+void
+cond_init(struct cond *c)
+{
+  c->seq = 0;
+}
+
+void
+cond_wait(struct cond *c, struct mutex *m)
+{
+  uint seq;
+
+  seq = c->seq;
+  mutex_unlock(m);
+  futex_wait(&c->seq, seq);
+  mutex_lock(m);
+}
+
+void
+cond_signal(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, 1);
+}
+
+void
+cond_broadcast(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, -1);
+}
@@ -4,6 +4,7 @@
 #include "x86.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "elf.h"
 
@@ -42,10 +43,9 @@ walkpgdir(pde_t *pgdir, const void *va, int alloc)
   if(*pde & PTE_P){
     pgtab = (pte_t*)P2V(PTE_ADDR(*pde));
   } else {
-    if(!alloc || (pgtab = (pte_t*)kalloc()) == 0)
+    // kzalloc makes sure all those PTE_P bits are zero.
+    if(!alloc || (pgtab = (pte_t*)kzalloc()) == 0)
       return 0;
-    // Make sure all those PTE_P bits are zero.
-    memset(pgtab, 0, PGSIZE);
     // The permissions here are overly generous, but they can
     // be further restricted by the permissions in the page table
     // entries, if necessary.
@@ -87,8 +87,9 @@ mappages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
 //
 // setupkvm() and exec() set up every page table like this:
 //
-//   0..KERNBASE: user memory (text+data+stack+heap), mapped to
+//   0..TIMEPAGE: user memory (text+data+stack+heap), mapped to
 //                phys memory allocated by the kernel
+//   TIMEPAGE..KERNBASE: the clock page, read-only to the user
 //   KERNBASE..KERNBASE+EXTMEM: mapped to 0..EXTMEM (for I/O space)
 //   KERNBASE+EXTMEM..data: mapped to EXTMEM..V2P(data)
 //                for the kernel's instructions and r/o data
@@ -121,9 +122,8 @@ setupkvm(void)
   pde_t *pgdir;
   struct kmap *k;
 
-  if((pgdir = (pde_t*)kalloc()) == 0)
+  if((pgdir = (pde_t*)kzalloc()) == 0)
     return 0;
-  memset(pgdir, 0, PGSIZE);
   if (P2V(PHYSTOP) > (void*)DEVSPACE)
     panic("PHYSTOP too high");
   for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
@@ -132,6 +132,10 @@ setupkvm(void)
       freevm(pgdir);
       return 0;
     }
+  if(mappages(pgdir, (void*)TIMEPAGE, PGSIZE, V2P(clockpage()), PTE_U) < 0){
+    freevm(pgdir);
+    return 0;
+  }
   return pgdir;
 }
 
@@ -186,8 +190,7 @@ inituvm(pde_t *pgdir, char *init, uint sz)
 
   if(sz >= PGSIZE)
     panic("inituvm: more than a page");
-  mem = kalloc();
-  memset(mem, 0, PGSIZE);
+  mem = kzalloc();
   mappages(pgdir, 0, PGSIZE, V2P(mem), PTE_W|PTE_U);
   memmove(mem, init, sz);
 }
@@ -224,20 +227,19 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
   char *mem;
   uint a;
 
-  if(newsz >= KERNBASE)
+  if(newsz > TIMEPAGE)
     return 0;
   if(newsz < oldsz)
     return oldsz;
 
   a = PGROUNDUP(oldsz);
   for(; a < newsz; a += PGSIZE){
-    mem = kalloc();
+    mem = kzalloc();
     if(mem == 0){
       cprintf("allocuvm out of memory\n");
       deallocuvm(pgdir, newsz, oldsz);
       return 0;
     }
-    memset(mem, 0, PGSIZE);
     if(mappages(pgdir, (char*)a, PGSIZE, V2P(mem), PTE_W|PTE_U) < 0){
       cprintf("allocuvm out of memory (2)\n");
       deallocuvm(pgdir, newsz, oldsz);
@@ -287,7 +289,7 @@ freevm(pde_t *pgdir)
 
   if(pgdir == 0)
     panic("freevm: no pgdir");
-  deallocuvm(pgdir, KERNBASE, 0);
+  deallocuvm(pgdir, TIMEPAGE, 0);
   for(i = 0; i < NPDENTRIES; i++){
     if(pgdir[i] & PTE_P){
       char * v = P2V(PTE_ADDR(pgdir[i]));
@@ -297,6 +299,46 @@ freevm(pde_t *pgdir)
   kfree((char*)pgdir);
 }
 
+// A new address space with one user, for pgdir of sz bytes.
+// Returns 0 if there is no memory for it.
+struct vmspace*
+vmcreate(pde_t *pgdir, uint sz)
+{
+  struct vmspace *vm;
+
+  if((vm = kmalloc(sizeof(*vm))) == 0)
+    return 0;
+  initlock(&vm->lock, "vmspace");
+  vm->ref = 1;
+  vm->sz = sz;
+  vm->pgdir = pgdir;
+  return vm;
+}
+
+// One more process, a clone()d thread, uses vm.
+void
+vmget(struct vmspace *vm)
+{
+  acquire(&vm->lock);
+  vm->ref++;
+  release(&vm->lock);
+}
+
+// A process is done with vm; free it after the last one.
+void
+vmput(struct vmspace *vm)
+{
+  int ref;
+
+  acquire(&vm->lock);
+  ref = --vm->ref;
+  release(&vm->lock);
+  if(ref == 0){
+    freevm(vm->pgdir);
+    kmfree(vm);
+  }
+}
+
 // Clear PTE_U on a page. Used to create an inaccessible
 // page beneath the user stack.
 void
@@ -117,6 +117,37 @@ sti(void)
   asm volatile("sti");
 }
 
+// Enable interrupts and wait for one.  sti takes effect
+// after the next instruction, so no interrupt can be taken
+// between the two and then missed by hlt.
+static inline void
+stihlt(void)
+{
+  asm volatile("sti; hlt");
+}
+
+// Cycles since reset.
+static inline uint64
+rdtsc(void)
+{
+  uint64 t;
+  asm volatile("rdtsc" : "=A" (t));
+  return t;
+}
+
+// n / d, without needing libgcc's 64-bit divide.
+static inline uint64
+div64(uint64 n, uint d)
+{
+  uint hi, lo, r;
+
+  hi = n >> 32;
+  r = hi % d;
+  hi /= d;
+  asm("divl %4" : "=a" (lo), "=d" (r) : "0" ((uint)n), "1" (r), "rm" (d));
+  return (uint64)hi << 32 | lo;
+}
+
 static inline uint
 xchg(volatile uint *addr, uint newval)
 {
@@ -130,6 +161,19 @@ xchg(volatile uint *addr, uint newval)
   return result;
 }
 
+// Store newval at addr if it holds old; return what it held.
+static inline uint
+cmpxchg(volatile uint *addr, uint old, uint newval)
+{
+  uint result;
+
+  asm volatile("lock; cmpxchgl %2, %1" :
+               "=a" (result), "+m" (*addr) :
+               "r" (newval), "0" (old) :
+               "cc", "memory");
+  return result;
+}
+
 static inline uint
 rcr2(void)
 {